@@ -12,6 +12,7 @@ PROJECT = ArnLib
 #
 # CONFIG += ArnRealFloat   # Use float as real type, default is double. Must be same in application & lib pro-file.
 # CONFIG += mDnsIntern     # Use internal mDNS code for zero-config (no external dependency)
+# CONFIG += ArnZlib        # Support negotiated compression of sync traffic (zlib dependency)
 ARN += server
 ARN += discover
 ARN += qml
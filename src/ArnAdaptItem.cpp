@@ -334,6 +334,24 @@ bool  ArnAdaptItem::isAutoDestroy()  const
 }
 
 
+ArnAdaptItem&  ArnAdaptItem::setPrio()
+{
+    Q_D(ArnAdaptItem);
+
+    MUTEX_CALL( ArnBasicItem::setPrio())
+    return *this;
+}
+
+
+bool  ArnAdaptItem::isPrio()  const
+{
+    Q_D(const ArnAdaptItem);
+
+    MUTEX_CALL( bool r = ArnBasicItem::isPrio())
+    return r;
+}
+
+
 void  ArnAdaptItem::arnImport( const QByteArray& data, int ignoreSame)
 {
     Q_D(const ArnAdaptItem);
@@ -39,6 +39,9 @@
 #include <QThreadStorage>
 #include <QCoreApplication>
 #include <QThread>
+#include <QVector>
+#include <QMutex>
+#include <QHash>
 #include <QDebug>
 
 
@@ -50,11 +53,13 @@ ArnBasicItemPrivate::ArnBasicItemPrivate()
     _reference       = arnNullptr;
     _eventHandler    = arnNullptr;
     _pendingEvChain  = arnNullptr;
+    _conflateDropCount = 0;
     _id              = quint32(_idCount.fetchAndAddRelaxed(1));
 
     _useUncrossed    = false;
     _isStdEvHandler  = true;
     _isAssigning     = false;
+    _isConflate.storeRelease(0);
     _ignoreSameValue = ArnM::defaultIgnoreSameValue();
     _isOnlyEcho      = true;  // Nothing else yet ...
 
@@ -158,6 +163,8 @@ void  ArnBasicItem::close()
 
     _link->unsubscribe( this);
     // Now this item will not get ArnEvent updates in its
+    if (_link->isThreaded())
+        ArnBasicItemEventHandler::cancelBatch( this);  // Nor any already batched
 
     ArnEvRefChange ev(-1);
     sendArnEventLink( &ev);
@@ -272,6 +279,14 @@ quint32  ArnBasicItem::localUpdateCount()  const
 }
 
 
+quint32  ArnBasicItem::valueVersion()  const
+{
+    if (!_link)  return 0;
+
+    return _link->valueVersion();
+}
+
+
 uint  ArnBasicItem::retireType()
 {
     return _link ? _link->retireType() : uint( ArnLink::RetireType::None);
@@ -418,6 +433,23 @@ bool  ArnBasicItem::isAutoDestroy()  const
 }
 
 
+ArnBasicItem&  ArnBasicItem::setPrio()
+{
+    if (_link) {
+        ArnM::errorLog( QString("Setting item/link to prio"),
+                            ArnError::AlreadyOpen);
+    }
+    addSyncMode( Arn::ObjectSyncMode::Prio, true);
+    return *this;
+}
+
+
+bool  ArnBasicItem::isPrio()  const
+{
+    return syncMode().is( Arn::ObjectSyncMode::Prio);
+}
+
+
 void  ArnBasicItem::addMode( Arn::ObjectMode mode)
 {
     Q_D(ArnBasicItem);
@@ -469,6 +501,33 @@ bool  ArnBasicItem::isIgnoreSameValue()  const
 }
 
 
+void  ArnBasicItem::setConflate( bool isConflate)
+{
+    Q_D(ArnBasicItem);
+
+    isConflate = isPipeMode() ? false : isConflate;
+    if (isConflate && !d->_isConflate.loadAcquire())
+        d->_conflatePending.fetchAndStoreOrdered(0);  // Forget changes counted in an earlier period
+    d->_isConflate.storeRelease( isConflate);
+}
+
+
+bool  ArnBasicItem::isConflate()  const
+{
+    Q_D(const ArnBasicItem);
+
+    return d->_isConflate.loadAcquire() != 0;
+}
+
+
+quint32  ArnBasicItem::conflateDropCount()  const
+{
+    Q_D(const ArnBasicItem);
+
+    return d->_conflateDropCount;
+}
+
+
 QString  ArnBasicItem::path( Arn::NameF nameF)  const
 {
     if (!_link)  return QString();
@@ -1342,13 +1401,58 @@ ArnBasicItemEventHandler*  ArnBasicItem::getThreadEventHandler()
 {
     static QThreadStorage<ArnBasicItemEventHandler*>  evHandlers;
 
-    if (!evHandlers.hasLocalData())
-        evHandlers.setLocalData( new ArnBasicItemEventHandler);
+    if (!evHandlers.hasLocalData()) {
+        ArnBasicItemEventHandler*  evHandler = new ArnBasicItemEventHandler;
+        evHandler->registerBatch();
+        evHandlers.setLocalData( evHandler);
+    }
 
     return evHandlers.localData();
 }
 
 
+//// ArnEvents to other threads are batched per recipient thread, see ArnLink::sendArnEvent()
+struct ArnEvBatchEntry {
+    ArnEvent*  ev;
+    QList<ArnCoreItem*>  recipients;  // Closed recipients are set to null
+    QVector<bool>  isCounted;         // Recipient value change counted in its _conflatePending
+};
+
+
+struct ArnEvBatchQueue {
+    ArnBasicItemEventHandler*  handler;
+    QList<ArnEvBatchEntry*>  queue;   // Waiting for delivery
+    QList<ArnEvBatchEntry*>  active;  // Being delivered
+    bool  isPosted;
+};
+
+typedef QHash<QThread*,ArnEvBatchQueue*>  ArnEvBatchTab;
+
+
+static QMutex*  batchMutex()
+{
+    static QMutex  mutex;
+
+    return &mutex;
+}
+
+
+static ArnEvBatchTab&  batchTab()
+{
+    static ArnEvBatchTab  tab;
+
+    return tab;
+}
+
+
+static QEvent::Type  batchEvType()
+{
+    static int  evType = QEvent::registerEventType();
+
+    return QEvent::Type( evType);
+}
+
+
 ArnBasicItemEventHandler::ArnBasicItemEventHandler( QObject* parent)
     : QObject( parent)
 {
@@ -1357,6 +1461,151 @@ ArnBasicItemEventHandler::ArnBasicItemEventHandler( QObject* parent)
 
 ArnBasicItemEventHandler::~ArnBasicItemEventHandler()
 {
+    QMutexLocker  locker( batchMutex());
+
+    ArnEvBatchTab&  tab = batchTab();
+    ArnEvBatchTab::iterator  it = tab.find( thread());
+    if ((it == tab.end())  ||  (it.value()->handler != this))  return;  // Not registered
+
+    ArnEvBatchQueue*  batchQueue = it.value();
+    tab.erase( it);
+    foreach (ArnEvBatchEntry* entry, batchQueue->queue) {
+        delete entry->ev;
+        delete entry;
+    }
+    delete batchQueue;
+}
+
+
+/// Only done for the common event handler in each thread
+void  ArnBasicItemEventHandler::registerBatch()
+{
+    ArnEvBatchQueue*  batchQueue = new ArnEvBatchQueue;
+    batchQueue->handler  = this;
+    batchQueue->isPosted = false;
+
+    QMutexLocker  locker( batchMutex());
+    batchTab().insert( thread(), batchQueue);
+}
+
+
+/// Threaded - must be threadsafe
+/// Takes ownership of ev if returning true, otherwise caller must deliver it
+bool  ArnBasicItemEventHandler::postBatch( QThread* thread, ArnEvent* ev,
+                                          const QList<ArnCoreItem*>& recipients)
+{
+    QMutexLocker  locker( batchMutex());
+
+    ArnEvBatchQueue*  batchQueue = batchTab().value( thread, arnNullptr);
+    if (!batchQueue)  return false;  // No common event handler in this thread
+
+    ArnEvBatchEntry*  entry = new ArnEvBatchEntry;
+    entry->ev         = ev;
+    entry->recipients = recipients;
+    entry->isCounted  = QVector<bool>( recipients.size(), false);
+    if (ev->type() == ArnEvValueChange::type()) {
+        for (int j = 0; j < recipients.size(); ++j) {
+            ArnBasicItemPrivate*  d = recipients.at(j)->d_ptr;
+            if (d->_isConflate.loadAcquire()) {
+                d->_conflatePending.ref();
+                entry->isCounted[j] = true;  // Flag might change before delivery
+            }
+        }
+    }
+    batchQueue->queue += entry;
+    if (!batchQueue->isPosted) {  // Only one posted event per burst
+        batchQueue->isPosted = true;
+        QCoreApplication::postEvent( batchQueue->handler, new QEvent( batchEvType()));
+    }
+    return true;
+}
+
+
+/// Threaded - must be threadsafe
+void  ArnBasicItemEventHandler::cancelBatch( ArnCoreItem* recipient)
+{
+    QMutexLocker  locker( batchMutex());
+
+    foreach (ArnEvBatchQueue* batchQueue, batchTab()) {
+        for (int i = 0; i < 2; ++i) {
+            const QList<ArnEvBatchEntry*>&  entries = i ? batchQueue->active : batchQueue->queue;
+            foreach (ArnEvBatchEntry* entry, entries) {
+                int  recNum = entry->recipients.size();
+                for (int j = 0; j < recNum; ++j) {
+                    if (entry->recipients.at(j) != recipient)  continue;
+
+                    entry->recipients[j] = arnNullptr;
+                    ArnBasicItemPrivate*  d = recipient->d_ptr;
+                    if (entry->isCounted.at(j))  // Counted when batched, never delivered
+                        d->_conflatePending.deref();
+                }
+            }
+        }
+    }
+}
+
+
+void  ArnBasicItemEventHandler::deliverBatch()
+{
+    QMutex*  mutex = batchMutex();
+
+    mutex->lock();
+    ArnEvBatchQueue*  batchQueue = batchTab().value( thread(), arnNullptr);
+    if (!batchQueue) {
+        mutex->unlock();
+        return;
+    }
+    // Only deliver what is queued now, a fast producer must not starve this event loop
+    int  entryNum = batchQueue->queue.size();
+    mutex->unlock();
+
+    for (int i = 0; i < entryNum; ++i) {
+        mutex->lock();
+        if (batchQueue->queue.isEmpty()) {
+            mutex->unlock();
+            break;
+        }
+        ArnEvBatchEntry*  entry = batchQueue->queue.takeFirst();
+        batchQueue->active += entry;
+        mutex->unlock();
+
+        int  recNum = entry->recipients.size();
+        for (int j = 0; j < recNum; ++j) {
+            mutex->lock();
+            ArnCoreItem*  recipient = entry->recipients.at(j);
+            mutex->unlock();
+            if (!recipient)  continue;  // Closed after event was posted
+
+            ArnBasicItemPrivate*  d = recipient->d_ptr;
+            if (entry->isCounted.at(j)) {
+                if (d->_conflatePending.fetchAndAddOrdered(-1) > 1) {  // A later change is pending
+                    ++d->_conflateDropCount;
+                    continue;
+                }
+            }
+
+            if (!d->_isStdEvHandler  &&  d->_eventHandler  &&  (d->_eventHandler->thread() != thread())) {
+                //// Custom handler in another thread, posted to it as when not batched
+                recipient->sendArnEventItem( entry->ev->makeHeapClone(), true);
+                continue;
+            }
+            entry->ev->setAccepted( true);  // Default
+            recipient->sendArnEventItem( entry->ev, false);
+        }
+
+        mutex->lock();
+        batchQueue->active.removeOne( entry);
+        mutex->unlock();
+        delete entry->ev;
+        delete entry;
+    }
+
+    mutex->lock();
+    if (batchQueue->queue.isEmpty())
+        batchQueue->isPosted = false;
+    else
+        QCoreApplication::postEvent( this, new QEvent( batchEvType()));
+    mutex->unlock();
 }
 
 
@@ -1374,8 +1623,9 @@ void  ArnBasicItemEventHandler::defaultEvent( QEvent* ev)
         // qDebug() << "ArnBasicEvModeChange: path=" << e->path() << " mode=" << e->mode()
         //          << " inItemPath=" << target->path();
         if (!target->isFolder()) {
-            if (e->mode().is( Arn::ObjectMode::Pipe)) {  // Pipe-mode never IgnoreSameValue
+            if (e->mode().is( Arn::ObjectMode::Pipe)) {  // Pipe-mode never IgnoreSameValue nor Conflate
                 target->setIgnoreSameValue(false);
+                target->setConflate(false);
             }
         }
         return;
@@ -1400,5 +1650,9 @@ void  ArnBasicItemEventHandler::defaultEvent( QEvent* ev)
 
 void  ArnBasicItemEventHandler::customEvent( QEvent* ev)
 {
+    if (ev->type() == batchEvType()) {
+        deliverBatch();
+        return;
+    }
     defaultEvent( ev);
 }
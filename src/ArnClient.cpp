@@ -35,12 +35,22 @@
 #include "ArnInc/ArnLib.hpp"
 #include "ArnSync.hpp"
 #include "ArnSyncLogin.hpp"
+#include "ArnSyncShm.hpp"
 #include <QSslSocket>
+#include <QLocalSocket>
 #include <QStringList>
 #include <QTimer>
 #include <QMap>
 #include <QMutexLocker>
 #include <QDebug>
+#ifdef Q_OS_UNIX
+# include <unistd.h>
+#endif
+
+#define LOCALHOST_PREFIX   "local:"  // Host for a local socket, e.g. "local:arnserver"
+#define SHMHOST_PREFIX     "shm:"    // Host for shared memory, e.g. "shm:arnserver"
+#define LOCALCONNECT_TIME  1000      // ms
+#define SHM_RINGSIZE       0x100000  // Bytes in each direction
 
 using Arn::XStringMap;
 
@@ -625,6 +635,23 @@ bool  ArnClient::isEncrypted()  const
 }
 
 
+void  ArnClient::setCompress( bool isCompress)
+{
+    Q_D(ArnClient);
+    if (d->_isClosed) {  // Must not have started connection ...
+        d->_arnNetSync->setCompress( isCompress);
+    }
+}
+
+
+bool  ArnClient::isCompressed()  const
+{
+    Q_D(const ArnClient);
+
+    return d->_arnNetSync->isCompress();
+}
+
+
 int ArnClient::curPrio()  const
 {
     Q_D(const ArnClient);
@@ -660,6 +687,41 @@ bool  ArnClient::getTraffic( quint64& in, quint64& out)  const
 }
 
 
+bool  ArnClient::getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const
+{
+    Q_D(const ArnClient);
+
+    d->_arnNetSync->getTraffic( in, out, inRaw, outRaw);
+    return true;
+}
+
+
+bool  ArnClient::getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const
+{
+    Q_D(const ArnClient);
+
+    d->_arnNetSync->getWriteBatchStat( writes, records, maxRecords);
+    return true;
+}
+
+
+bool  ArnClient::getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const
+{
+    Q_D(const ArnClient);
+
+    d->_arnNetSync->getQueueDelayStat( isPrio, count, totalUsec, maxUsec);
+    return true;
+}
+
+
+Arn::XStringMap  ArnClient::commandStat()  const
+{
+    Q_D(const ArnClient);
+
+    return d->_arnNetSync->commandStat();
+}
+
+
 void  ArnClient::commandGet( const QString& path)
 {
     Q_D(ArnClient);
@@ -1085,7 +1147,12 @@ void  ArnClient::doConnectArnLogic()
         port = Arn::defaultTcpPort;
 
     d->_socket->abort();
-    d->_socket->connectToHost( Arn::hostFromHostWithInfo( arnHost), port);
+    d->_arnNetSync->setShm( arnNullptr);
+    QString  hostName = Arn::hostFromHostWithInfo( arnHost);
+    bool  isShm   = hostName.startsWith( SHMHOST_PREFIX);
+    bool  isLocal = isShm || hostName.startsWith( LOCALHOST_PREFIX);
+    if (!isLocal)
+        d->_socket->connectToHost( hostName, port);
     d->_curConnectAP.addr = arnHost;
     d->_curConnectAP.port = port;
     d->_curPrio           = curPrio;
@@ -1093,6 +1160,58 @@ void  ArnClient::doConnectArnLogic()
 
     d->_arnNetSync->connectStarted();
     emit connectionStatusChanged( d->_connectStat, d->_curPrio);
+
+    if (isLocal)
+        connectToLocal( hostName.mid( hostName.indexOf(':') + 1), isShm);
+}
+
+
+/// Same host ArnServer, the ArnSync protocol is used over a Unix domain socket
+/// or over shared memory setup by the socket
+void  ArnClient::connectToLocal( const QString& serverName, bool isShm)
+{
+    Q_D(ArnClient);
+
+    QAbstractSocket::SocketError  socketError = QAbstractSocket::UnsupportedSocketOperationError;
+#ifdef Q_OS_UNIX
+    QLocalSocket  localSocket;
+    localSocket.connectToServer( serverName);
+    QString  errTxt;
+    if (localSocket.waitForConnected( LOCALCONNECT_TIME)) {
+        //// The socket is taken over, QSslSocket is used the same way as for tcp
+        int  fd = ::dup( int( localSocket.socketDescriptor()));
+        localSocket.abort();
+        ArnSyncShm*  shm = arnNullptr;
+        if (isShm && (fd >= 0)) {  // Shared memory and its eventfds are passed to the server
+            shm = ArnSyncShm::create( SHM_RINGSIZE);
+            if (!shm || !shm->sendSetup( fd)) {
+                errTxt = ArnSyncShm::isSupported() ? "Shared memory setup failed" : "No shared memory";
+                delete shm;
+                shm = arnNullptr;
+                ::close( fd);
+                fd = -1;
+            }
+        }
+        if ((fd >= 0) && d->_socket->setSocketDescriptor( fd)) {
+            d->_arnNetSync->setShm( shm);
+            QMetaObject::invokeMethod( this, "doTcpConnected", Qt::QueuedConnection);
+            return;
+        }
+        delete shm;
+        if (fd >= 0)
+            ::close( fd);
+    }
+    else {
+        socketError = QAbstractSocket::SocketError( localSocket.error());  // Same enum values
+    }
+    ArnM::errorLog( QString(tr("Local Client Msg:")) + (errTxt.isEmpty() ? localSocket.errorString() : errTxt) +
+                    " server=" + serverName, ArnError::ConnectionError);
+#else
+    ArnM::errorLog( QString(tr("Local Client Msg: Not supported on this platform, server=")) +
+                    serverName, ArnError::ConnectionError);
+#endif
+    QMetaObject::invokeMethod( this, "doTcpError", Qt::QueuedConnection,
+                               Q_ARG( int, int( socketError)));
 }
 
 
@@ -146,7 +146,9 @@ public:
         //! The client is default generator of data
         Master      = 0x02,
         //! Destroy this _Arn Data Object_ when client (tcp/ip) closes
-        AutoDestroy = 0x04
+        AutoDestroy = 0x04,
+        //! Value updates are sent before any normal priority updates
+        Prio        = 0x08
     };
     MQ_DECLARE_FLAGSTXT( ObjectSyncMode)
 };
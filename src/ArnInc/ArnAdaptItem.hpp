@@ -341,6 +341,17 @@ public:
      */
     bool  isAutoDestroy()  const;
 
+    //! Set client session _sync mode_ as _Prio_ for this ArnItem
+    /*! Value updates of this ArnItem are sent before queued normal priority updates.
+     *  \pre This must be set before open().
+     */
+    ArnAdaptItem&  setPrio();
+
+    /*! \retval true if _Prio mode_
+     *  \see setPrio()
+     */
+    bool  isPrio()  const;
+
     //! Import data to an _Arn Data Object_
     /*! Data blob from a previos \p arnExport() can be imported.
      *  This is essentially assigning the _Arn Data Object_ with same as exported.
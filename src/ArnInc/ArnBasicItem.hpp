@@ -47,6 +47,7 @@
 class ArnBasicItemPrivate;
 class ArnLink;
 class ArnEvent;
+class QThread;
 
 
 //! \cond ADV
@@ -59,9 +60,16 @@ public:
     virtual ~ArnBasicItemEventHandler();
 
     static void  defaultEvent( QEvent* ev);
+    static bool  postBatch( QThread* thread, ArnEvent* ev, const QList<ArnCoreItem*>& recipients);
+    static void  cancelBatch( ArnCoreItem* recipient);
 
 protected:
     virtual void  customEvent( QEvent* ev);
+
+private:
+    friend class ArnBasicItem;
+    void  registerBatch();
+    void  deliverBatch();
 };
 //! \endcond
 
@@ -236,6 +244,25 @@ public:
      */
     bool  isIgnoreSameValue()  const;
 
+    //! Set conflating of value changes from other threads
+    /*! When this item is slower than the updates from another thread, value changes
+     *  pending for this item are collapsed, only the latest is delivered.
+     *  \param[in] isConflate If true, intermediate changed signals are dropped.
+     *  \note Not used in pipe mode, where every value must be delivered
+     *  \see conflateDropCount()
+     */
+    void  setConflate( bool isConflate = true);
+
+    /*! \retval true if conflating value changes
+     *  \see setConflate()
+     */
+    bool  isConflate()  const;
+
+    /*! \return Number of dropped intermediate value changes
+     *  \see setConflate()
+     */
+    quint32  conflateDropCount()  const;
+
     //! Add _general mode_ settings for this _Arn Data Object_
     /*! If this ArnItem is in closed state, the added modes will be stored and
      *  the real mode change is done when this ArnItem is opened to an
@@ -335,6 +362,19 @@ public:
      */
     bool  isAutoDestroy()  const;
 
+    //! Set client session _sync mode_ as _Prio_ for this ArnItem
+    /*! Value updates of this ArnItem are sent before queued normal priority updates,
+     *  e.g. for control values that must not wait behind bulk data.
+     *  Updates that are part of a transaction keep the transaction order.
+     *  \pre This must be set before open().
+     */
+    ArnBasicItem&  setPrio();
+
+    /*! \retval true if _Prio mode_
+     *  \see setPrio()
+     */
+    bool  isPrio()  const;
+
     //! Import data to an _Arn Data Object_
     /*! Data blob from a previos \p arnExport() can be imported.
      *  This is essentially assigning the _Arn Data Object_ with same as exported.
@@ -583,6 +623,7 @@ public:
     bool  sendArnEventLink( ArnEvent* ev);
     void  sendArnEventItem( ArnEvent* ev, bool isAlienThread, bool isLocked = false);
     quint32  localUpdateCount()  const;
+    quint32  valueVersion()  const;
 
 protected:
     virtual void  arnEvent( QEvent* ev, bool isAlienThread);
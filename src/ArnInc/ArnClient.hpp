@@ -155,7 +155,12 @@ public:
     void  connectToArnList();
 
     //! Connect to an _Arn Server_
-    /*! \param[in] arnHost is host name or ip address, e.g. "192.168.1.1".
+    /*! An _Arn Server_ on the same host, started with ArnServer::startLocal(), is
+     *  connected via a local socket by using "local:" + serverName as arnHost,
+     *  e.g. "local:arnserver". The port is then not used. Only available on Unix.
+     *  A server started with ArnServer::startShm() is connected by "shm:" + serverName,
+     *  the records are then passed in shared memory. Only available on Linux.
+     *  \param[in] arnHost is host name or ip address, e.g. "192.168.1.1".
      *  \param[in] port is the host port, 0 gives Arn::defaultTcpPort.
      *  \see Arn::makeHostWithInfo()
      *  \see connectToArnList()
@@ -363,6 +368,15 @@ public:
      */
     void  setEncryptPolicy( const Arn::EncryptPolicy& pol);
 
+    //! Set clients wish for compression of the sync traffic
+    /*! Compression is negotiated at connection start. It is only used if both client and
+     *  server are built with zlib (CONFIG += ArnZlib). This must be used before connection
+     *  is started. Default is no compression.
+     *  \param[in] isCompress is true if compression is wanted.
+     *  \see isCompressed()
+     */
+    void  setCompress( bool isCompress);
+
     //! Generate a hashed password from clear text password
     /*! \param[in] password is the clear text password.
      *  \return the hashed password, e.g "{A5ha62Aug}"
@@ -434,6 +448,12 @@ public:
      */
     bool  isEncrypted()  const;
 
+    //! Is current Arn Connection compressed
+    /*! \retval true if sync traffic is compressed.
+     *  \see setCompress()
+     */
+    bool  isCompressed()  const;
+
     //! Send chat message to server
     /*! This is used for a chat session between client and server.
      *  \param[in] text is the message.
@@ -457,6 +477,43 @@ public:
      */
     bool  getTraffic( quint64& in, quint64& out)  const;
 
+    //! Get traffic metrics before and after compression
+    /*! \retval true if ok.
+     *  \param[out] in is the clients received number of bytes.
+     *  \param[out] out is the clients sent number of bytes.
+     *  \param[out] inRaw is the clients received number of bytes after decompression.
+     *  \param[out] outRaw is the clients sent number of bytes before compression.
+     *  \see setCompress()
+     */
+    bool  getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const;
+
+    //! Get write batching metrics
+    /*! Queued records are coalesced into one socket write, limited by
+     *  Arn::writeBatchMaxBytes and Arn::writeBatchMaxRecords.
+     *  \retval true if ok.
+     *  \param[out] writes is the number of batched socket writes.
+     *  \param[out] records is the total number of records in these writes.
+     *  \param[out] maxRecords is the largest number of records in a single write.
+     */
+    bool  getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const;
+
+    //! Get send queue delay metrics for a priority class
+    /*! The delay is from when a value update is queued until it is sent.
+     *  \retval true if ok.
+     *  \param[in] isPrio selects the _Prio_ class, otherwise the normal class.
+     *  \param[out] count is the number of sent updates.
+     *  \param[out] totalUsec is the sum of their delays in microseconds.
+     *  \param[out] maxUsec is the largest delay in microseconds.
+     *  \see ArnItem::setPrio()
+     */
+    bool  getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const;
+
+    //! Get received record metrics
+    /*! Used for profiling the sync protocol.
+     *  \return command name as key and number of received records as value.
+     */
+    Arn::XStringMap  commandStat()  const;
+
     //! \cond ADV
     int  curPrio()  const;
 
@@ -570,6 +627,7 @@ private:
     void  startConnectArn();
     void  reConnectArn();
     void  doConnectArnLogic();
+    void  connectToLocal( const QString& serverName, bool isShm);
     static QString  toRemotePathCB( void* context, const QString& path);
 
     QStringList  makeItemList( Arn::XStringMap& xsMap);
@@ -147,6 +147,28 @@ public:
     bool  isIgnoreSameValue()
     {return ArnItemB::isIgnoreSameValue();}
 
+    //! Set conflating of value changes from other threads
+    /*! When this item is slower than the updates from another thread, value changes
+     *  pending for this item are collapsed, only the latest gives a changed signal.
+     *  \param[in] isConflate If true, intermediate changed signals are dropped.
+     *  \note Not used in pipe mode, where every value must be delivered
+     *  \see conflateDropCount()
+     */
+    void  setConflate( bool isConflate = true)
+    {ArnItemB::setConflate( isConflate);}
+
+    /*! \retval true if conflating value changes
+     *  \see setConflate()
+     */
+    bool  isConflate()
+    {return ArnItemB::isConflate();}
+
+    /*! \return Number of dropped intermediate value changes
+     *  \see setConflate()
+     */
+    quint32  conflateDropCount()
+    {return ArnItemB::conflateDropCount();}
+
     //! Add _general mode_ settings for this _Arn Data Object_
     /*! If this ArnItem is in closed state, the added modes will be stored and
      *  the real mode change is done when this ArnItem is opened to an
@@ -264,6 +286,19 @@ public:
     bool  isAutoDestroy()  const
     {return ArnItemB::isAutoDestroy();}
 
+    //! Set client session _sync mode_ as _Prio_ for this ArnItem
+    /*! Value updates of this ArnItem are sent before queued normal priority updates.
+     *  \pre This must be set before open().
+     */
+    ArnItem&  setPrio()
+    {ArnItemB::setPrio(); return *this;}
+
+    /*! \retval true if _Prio mode_
+     *  \see setPrio()
+     */
+    bool  isPrio()  const
+    {return ArnItemB::isPrio();}
+
     //! Set a Bidirectional item as Uncrossed
     /*! The two way object is not twisted at writes, i.e. exactly the same object is read
      *  and written. This has no effect on an _Arn Data Object_ that not is in
@@ -248,6 +248,9 @@ protected:
     using ArnBasicItem::isProvider;
     using ArnBasicItem::type;
     using ArnBasicItem::setIgnoreSameValue;
+    using ArnBasicItem::setConflate;
+    using ArnBasicItem::isConflate;
+    using ArnBasicItem::conflateDropCount;
     using ArnBasicItem::addMode;
     using ArnBasicItem::getMode;
     using ArnBasicItem::syncMode;
@@ -261,6 +264,8 @@ protected:
     using ArnBasicItem::isMaster;
     using ArnBasicItem::setAutoDestroy;
     using ArnBasicItem::isAutoDestroy;
+    using ArnBasicItem::setPrio;
+    using ArnBasicItem::isPrio;
     using ArnBasicItem::setUncrossed;
     using ArnBasicItem::isUncrossed;
     using ArnBasicItem::arnExport;
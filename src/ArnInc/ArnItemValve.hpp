@@ -143,6 +143,19 @@ public:
     bool  isAutoDestroy()  const
     {return ArnItemB::isAutoDestroy();}
 
+    //! Set client session _sync mode_ as _Prio_ for this ArnItem
+    /*! Value updates of this ArnItem are sent before queued normal priority updates.
+     *  \pre This must be set before open().
+     */
+    ArnItemValve&  setPrio()
+    {ArnItemB::setPrio(); return *this;}
+
+    /*! \retval true if _Prio mode_
+     *  \see setPrio()
+     */
+    bool  isPrio()  const
+    {return ArnItemB::isPrio();}
+
     /*! \return state of this valve 1 = Enabled selected stream(s)
      */
     bool  toBool()  const;
@@ -52,6 +52,14 @@ extern bool  debugZeroConf;
 extern bool  debugMDNS;
 extern bool  warningMDNS;
 extern bool  offHeartbeat;
+extern bool  offLockFreeRead;
+
+// Refuse binary framed sync records, text records are then used also to new peers
+extern bool  offBinFrame;
+
+// High-water marks for records written together by one socket write in ArnSync
+extern int  writeBatchMaxBytes;
+extern int  writeBatchMaxRecords;
 
 extern const QString  resourceArnLib;
 extern const QString  resourceArnRoot;
@@ -54,7 +54,9 @@ public:
         //! this assignment. Typically used to avoid queue filling during a disconnected tcp.
         QueueFindRegexp = 0x01,
         //! For pipes. Sequence number is used and available in HandleData.
-        SeqNo           = 0x02
+        SeqNo           = 0x02,
+        //! Part of a multi item transaction. Batch id is available in HandleData.
+        Batch           = 0x04
     };
     Q_DECLARE_FLAGS( Codes, Code)
 
@@ -40,6 +40,7 @@
 #include <QIODevice>
 #include <QStringList>
 #include <QVector>
+#include <QHash>
 #include <QMetaType>
 #include <QObject>
 #include <QMutex>
@@ -238,6 +239,17 @@ public:
      */
     static void  setValue( const QString& path, const char* value);
 
+    //! Assign a set of values as one transaction
+    /*! All values are assigned before any subscriber is notified. Each changed
+     *  _Arn Data Object_ is then notified once, also when assigned several times.
+     *  Remote peers get the changed values of a transaction as one sync record.
+     *
+     *  Types _int_, _double_, _QString_ and _QByteArray_ are assigned as native
+     *  values, other types as _QVariant_.
+     *  \param[in] pathValues is map of _path_ to _value_
+     */
+    static void  setValues( const QVariantMap& pathValues);
+
     //! Load from a file to an _Arn Data Object_ at _path_
     /*! \param[in] path is the path of the _Arn Data Object_
      *  \param[in] fileName is the file to be loaded
@@ -264,6 +276,28 @@ public:
      */
     static bool  saveToFile( const QString& path, const QString& fileName, Arn::Coding coding);
 
+    //! Save a binary snapshot of a folder tree to a file
+    /*! Paths, types, values and modes of all _Arn Data Objects_ below the folder are saved.
+     *  Must be called from main thread.
+     *  \param[in] path is the folder to be saved
+     *  \param[in] fileName is the snapshot file
+     *  \retval true if saving is successful
+     *  \see loadSnapshot()
+     */
+    static bool  saveSnapshot( const QString& path, const QString& fileName);
+
+    //! Load a binary snapshot from a file to a folder tree
+    /*! The snapshot is loaded in one pass. Missing _Arn Data Objects_ are created in bulk,
+     *  creation is only notified when there is a subscriber in the folders above.
+     *  Existing _Arn Data Objects_ are assigned as normal.
+     *  Must be called from main thread.
+     *  \param[in] path is the folder to load to, can differ from the saved folder
+     *  \param[in] fileName is the snapshot file
+     *  \retval true if loading is successful
+     *  \see saveSnapshot()
+     */
+    static bool  loadSnapshot( const QString& path, const QString& fileName);
+
     static void  errorLog( QString errText, ArnError err = ArnError::Undef, void* reference = arnNullptr);
     static QString  errorSysName();
 
@@ -307,6 +341,15 @@ public slots:
      */
     static void  destroyLink( const QString& path, bool isGlobal = true);
 
+    //! Drop cached value representations below _path_
+    /*! Each _Arn Data Object_ keeps its value in the assigned type. Other representations,
+     *  e.g. a QString for an integer, are generated and cached when read. This drops
+     *  the caches to reduce memory usage, they are regenerated when needed.
+     *  \param[in] path to a folder or a leaf
+     *  \note Can be used when the application is low on memory
+     */
+    static void  dropValueCaches( const QString& path = QString("/"));
+
     static void  setupErrorlog( QObject* errLog);
 
 signals:
@@ -329,6 +372,7 @@ protected:
 
 private slots:
     void  postSetup();
+    void  reclaimRetired();
     void  onTimerMetrics();
     static void  linkProxy( ArnThreadCom* threadCom, const QString& path,
                             int flagValue, int syncMode = 0);
@@ -345,6 +389,7 @@ private:
                                Arn::ObjectSyncMode syncMode = Arn::ObjectSyncMode());
     static ArnLink*  linkThread( const QString& path, Arn::LinkFlags flags,
                                  Arn::ObjectSyncMode syncMode = Arn::ObjectSyncMode());
+    static ArnLink*  linkThreadFind( const QString& path, Arn::LinkFlags flags);
     static ArnLink*  linkMain( const QString& path, ArnLink *parent, const QString& name,
                                Arn::LinkFlags flags, Arn::ObjectSyncMode syncMode = Arn::ObjectSyncMode());
     static ArnLink*  addTwinMain( const QString& path, ArnLink* child,
@@ -355,10 +400,27 @@ private:
     static QStringList  itemsMain( const QString& path);
 
     static void  doZeroRefLink( ArnLink* link);
+    static void  dropValueCachesMain( ArnLink* link);
+    static ArnLink*  pathCacheFind( const QString& path, Arn::LinkFlags flags);
+    static void  pathCacheAdd( const QString& path, ArnLink* link);
+    static void  pathCacheRemove( ArnLink* link);
+    static bool  saveSnapshotLink( QByteArray& buf, QIODevice& dev, ArnLink* link);
+    static ArnLink*  snapshotLink( ArnLink* parent, const QString& name, Arn::LinkFlags flags,
+                                   Arn::ObjectSyncMode syncMode, bool isNotify);
+    static bool  isSubscribedToRoot( const ArnLink* link);
+    static void  destroyTreeMain( ArnLink* startLink, bool isGlobal);
+    static void  reclaimRetiredMain( int maxNum, ArnLink* topLink = arnNullptr);
 
     // The root object of all other arn data
     ArnLink*  _root;
 
+    // Resolved full paths to links, only used by main thread
+    QHash<QString,ArnLink*>  _pathCache;
+
+    // Retired links to be deleted in batches, folder always after its children
+    QList<ArnLink*>  _reclaimQueue;
+    bool  _isReclaimPosted;
+
     QVector<QString>  _errTextTab;
     bool  _consoleError;
     bool  _defaultIgnoreSameValue;
@@ -374,6 +436,8 @@ private:
     ArnLink*  _countFolderLink;
     ArnLink*  _countLeafLink;
     ArnLink*  _countRefLink;
+    ArnLink*  _countValueExtLink;
+    ArnLink*  _valueSizeLink;
     QTimer*  _timerMetrics;
 };
 
@@ -40,11 +40,11 @@
 #include <QHostAddress>
 #include <QMap>
 #include <QStringList>
+#include <QMutex>
 
 class ArnServerPrivate;
 class ArnSync;
 class ArnSyncLogin;
-class ArnItemNetEar;
 class ArnServer;
 class QTcpServer;
 class QSslSocket;
@@ -54,7 +54,7 @@ class ArnServerSession : public QObject
 {
     Q_OBJECT
 public:
-    ArnServerSession( QSslSocket* socket, ArnServer* arnServer);
+    ArnServerSession( QSslSocket* socket, ArnServer* arnServer, QObject* parent = arnNullptr);
 
     QSslSocket*  socket()  const;
     Arn::XStringMap  remoteWhoIAm()  const;
@@ -62,6 +62,10 @@ public:
     Arn::Allow  getAllow()  const;
     void  sendMessage( int type, const QByteArray& data = QByteArray());
     bool  getTraffic( quint64& in, quint64& out)  const;
+    bool  getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const;
+    bool  getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const;
+    bool  getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const;
+    Arn::XStringMap  commandStat()  const;
 
 signals:
     void  infoReceived( int type);
@@ -70,7 +74,9 @@ signals:
 
 private slots:
     void  shutdown();
-    void  doDestroyArnTree( const QString& path, bool isGlobal);
+    void  retire();
+    void  deleteInServerThread();
+    void  doSendMessage( int type, const QByteArray& data);
     void  onCommandDelete( const QString& path);
     void  doSyncStateChanged( int state);
 
@@ -78,7 +84,7 @@ private:
     QSslSocket*  _socket;
     ArnServer*  _arnServer;
     ArnSync*  _arnNetSync;
-    ArnItemNetEar*  _arnNetEar;
+    mutable QMutex  _mutex;  // Guards the _arnNetSync pointer against retire, the sync guards its own fields
 };
 
 
@@ -134,6 +140,38 @@ public:
      */
     QHostAddress  listenAddress();
 
+    //! Start the Arn _server_ also listening on a local socket
+    /*! ArnClients on the same host can connect with lower latency, using
+     *  ArnClient::connectToArn() with "local:" + _serverName_ as host.
+     *  The same ArnSync protocol and login is used as for tcp, a local session is
+     *  regarded as from localhost in isDemandLoginNet().
+     *  Any stale socket with the same name is removed. Only available on Unix.
+     *  \param[in] serverName is the name of the local socket, e.g. "arnserver".
+     *  \retval true if listening started.
+     *  \see localServerName()
+     */
+    bool  startLocal( const QString& serverName);
+
+    //! Name of the local socket of the Arn _server_
+    /*! \return the name, empty if not listening on a local socket.
+     *  \see startLocal()
+     */
+    QString  localServerName()  const;
+
+    //! Start the Arn _server_ also listening for shared memory clients
+    /*! ArnClients on the same host connect with ArnClient::connectToArn() using
+     *  "shm:" + _serverName_ as host. A local socket is used for setup and for detecting
+     *  a closed session, the records are passed in a ring buffer pair in shared memory.
+     *  This avoids a syscall for each write when the peer is busy, e.g. for high rate
+     *  producers. The same ArnSync protocol and login is used as for tcp. Encryption is not
+     *  possible, an EncryptPolicy of _MustHave_ denies these sessions.
+     *  Only available on Linux.
+     *  \param[in] serverName is the name of the setup socket, e.g. "arnserver_shm".
+     *  \retval true if listening started.
+     *  \see startLocal()
+     */
+    bool  startShm( const QString& serverName);
+
     //! Add an access entry
     /*! This adds an entry to build an access table for the server. This access table
      *  restricts the operations of connected clients. Each client refer to one entry
@@ -235,6 +273,24 @@ public:
      */
     void  setWhoIAm( const Arn::XStringMap& whoIAmXsm);
 
+    //! Set number of I/O threads for the sessions
+    /*! Default 0 gives all sessions in the thread of the ArnServer.
+     *  Otherwise each new session, with its socket and sync, is placed in the I/O thread
+     *  having the least sessions. The load of each thread is published under
+     *  Arn::pathServer + "IoThread/".
+     *  Signals from ArnServerSession are then queued to the ArnServer thread.
+     *  \param[in] threadNum is the number of I/O threads.
+     *  \pre This must be set before start().
+     *  \see ioThreadNum()
+     */
+    void  setIoThreadNum( int threadNum);
+
+    //! Get number of I/O threads for the sessions
+    /*! \return the number of I/O threads, 0 = sessions in the ArnServer thread.
+     *  \see setIoThreadNum()
+     */
+    int  ioThreadNum()  const;
+
     //! \cond ADV
     ArnSyncLogin*  arnLogin()  const;
     ArnServerSession*  getSession()  const;
@@ -250,8 +306,11 @@ protected:
 
 private slots:
     void tcpConnection();
+    void  localConnection();
+    void  onIoSession( QObject* sessionObj);
 
 private:
+    void  startIoThreads();
 };
 
 #endif // ARNSERVER_HPP
@@ -93,6 +93,8 @@ private:
     ArnBasicItem  _arnTraffic;
     ArnBasicItem  _arnTrafficIn;
     ArnBasicItem  _arnTrafficOut;
+    ArnBasicItem  _arnWriteBatch;
+    ArnBasicItem  _arnWriteBatchMax;
     QString  _clientHostName;
     QString  _clientAgent;
     QString  _clientUserName;
@@ -95,6 +95,9 @@ If this is not feasible, use option AnyKey.
 The XString can be imported to the XStringMap. To get back stored values,
 XStringMap is Queried with the keys or by index.
 
+For binary transports toBinary() gives a compact representation with typed fields
+and uncoded values, which is loaded by fromBinary().
+
 \code
     Arn::XStringMap xsm;
     xsm.add("", "put");
@@ -195,6 +198,11 @@ public:
     QString  toXStringString()  const;
     bool  fromXString( const QByteArray& inXString, int size=-1);
     bool  fromXString( const QString& inXString);
+    bool  fromXString( const char* inXString, int size);
+    QByteArray  toBinary()  const;
+    //! Same as toBinary() but the first value is replaced by _firstValNum_, e.g. a code
+    QByteArray  toBinary( quint32 firstValNum)  const;
+    bool  fromBinary( const char* data, int size);
 
     void  setEmptyKeysToValue();
     void  reverseOrder();
@@ -204,6 +212,7 @@ public:
 
     void  stringCode( QByteArray& dst, const QByteArray& src)  const;
     void  stringDecode( QByteArray& dst, const QByteArray& src)  const;
+    void  stringDecode( QByteArray& dst, const char* src, int srcSize)  const;
 
     inline void  append( const char* key, const QByteArray& val)
     {add( key, val);}
@@ -234,6 +243,7 @@ public:
 private:
     void  init();
     void  checkSpace();
+    QByteArray  toBinaryMain( const quint32* firstValNum)  const;
 
     QVector<QByteArray>  _keyList;
     QVector<QByteArray>  _valList;
@@ -43,6 +43,8 @@
 void  ArnItemNet::init()
 {
     _netId      = 0;
+    _batchId    = 0;
+    _queueTime  = 0;
     _dirty      = false;
     _dirtyMode  = false;
     _disable    = false;
@@ -54,6 +56,9 @@ void  ArnItemNet::init()
     _saveFlux   = false;
     _curEchoSeq = -1;
     _updateCountStop = 0;
+    _remoteLinkId       = 0;
+    _remoteValueVersion = 0;
+    _importValueVersion = 0;
 
     setUncrossed();
     setIgnoreSameValue( false);
@@ -122,6 +127,7 @@ void  ArnItemNet::addSyncModeString( const QByteArray& smode, bool linkShare)
     syncMode.set( syncMode.Master,      isMaster);
     syncMode.set( syncMode.AutoDestroy, smode.contains("autodestroy"));
     syncMode.set( syncMode.Monitor,     smode.contains("mon"));
+    syncMode.set( syncMode.Prio,        smode.contains("prio"));
 
     addSyncMode( syncMode, linkShare);
 }
@@ -138,6 +144,7 @@ QByteArray  ArnItemNet::getSyncModeString()  const
 
     if  (syncMode.is( syncMode.AutoDestroy))  smode += "autodestroy ";
     if  (syncMode.is( syncMode.Monitor))      smode += "mon ";
+    if  (syncMode.is( syncMode.Prio))         smode += "prio ";
 
     return smode.trimmed();
 }
@@ -238,6 +245,30 @@ int  ArnItemNet::queueNum()  const
 }
 
 
+void  ArnItemNet::setQueueTime( qint64 usec)
+{
+    _queueTime = usec;
+}
+
+
+qint64  ArnItemNet::queueTime()  const
+{
+    return _queueTime;
+}
+
+
+void  ArnItemNet::setBatchId( uint batchId)
+{
+    _batchId = batchId;
+}
+
+
+uint  ArnItemNet::batchId()  const
+{
+    return _batchId;
+}
+
+
 void  ArnItemNet::nextEchoSeq()
 {
     _curEchoSeq = (_curEchoSeq + 1) % 100;
@@ -378,6 +409,34 @@ void  ArnItemNet::onConnectStop()
 }
 
 
+/// Version of the remote value last imported, used for resume of the sync
+void  ArnItemNet::setRemoteVersion( uint remoteLinkId, quint32 remoteValueVersion)
+{
+    _remoteLinkId       = remoteLinkId;
+    _remoteValueVersion = remoteValueVersion;
+    _importValueVersion = valueVersion();  // Called just after the import
+}
+
+
+uint  ArnItemNet::remoteLinkId()  const
+{
+    return _remoteLinkId;
+}
+
+
+quint32  ArnItemNet::remoteValueVersion()  const
+{
+    return _remoteValueVersion;
+}
+
+
+/// Local value is still the imported remote version, i.e. no local change even if not sent
+bool  ArnItemNet::isRemoteVersionValid()  const
+{
+    return _remoteLinkId && (valueVersion() == _importValueVersion);
+}
+
+
 void  ArnItemNet::arnEvent( QEvent* ev, bool isAlienThread)
 {
     ArnBasicItem::arnEvent( ev, isAlienThread);
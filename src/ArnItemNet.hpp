@@ -64,6 +64,10 @@ public:
     void  setMonitor( bool isMonitor);
     void  setQueueNum( int num);
     int  queueNum()  const;
+    void  setQueueTime( qint64 usec);
+    qint64  queueTime()  const;
+    void  setBatchId( uint batchId);
+    uint  batchId()  const;
     void  nextEchoSeq();
     void  resetEchoSeq();
     void  setEchoSeq( qint8 echoSeq);
@@ -86,6 +90,10 @@ public:
     bool  isSaveFlux()  const;
     quint32  localUpdateSinceStop()  const;
     void  onConnectStop();
+    void  setRemoteVersion( uint remoteLinkId, quint32 remoteValueVersion);
+    uint  remoteLinkId()  const;
+    quint32  remoteValueVersion()  const;
+    bool  isRemoteVersionValid()  const;
 
     virtual void  arnEvent( QEvent* ev, bool isAlienThread);
 
@@ -113,7 +121,12 @@ private:
 
     uint  _netId;               // id used during sync over net
     int  _queueNum;             // number used in itemQueue
+    qint64  _queueTime;         // When queued for sending, used for queue delay statistics
+    uint  _batchId;             // transaction batch for queued flux, 0 = no batch
     quint32  _updateCountStop;  // Local update count at connection lost
+    uint  _remoteLinkId;        // Remote linkId of last imported value, 0 = unknown
+    quint32  _remoteValueVersion;  // Remote value version of last imported value
+    quint32  _importValueVersion;  // Local value version just after last imported value
     qint8  _curEchoSeq;         // Used to avoid obsolete echo
     bool  _dirty : 1;           // item has been updated but not yet sent
     bool  _dirtyMode : 1;       // item Mode has been updated but not yet sent
@@ -50,6 +50,12 @@ bool debugZeroConf    = false;
 bool debugMDNS        = false;
 bool warningMDNS      = false;
 bool offHeartbeat     = false;
+bool offLockFreeRead  = false;
+
+bool offBinFrame      = false;
+
+int  writeBatchMaxBytes   = 16384;
+int  writeBatchMaxRecords = 256;
 
 const QString  resourceArnLib  = ":/ArnLib/";
 const QString  resourceArnRoot = ":/ArnLib/ArnRoot/";
@@ -79,7 +79,8 @@ contains(ARN, client) {
         $$PWD/ArnSapi.cpp \
         $$PWD/ArnMonitor.cpp \
         $$PWD/ArnSync.cpp \
-        $$PWD/ArnSyncLogin.cpp
+        $$PWD/ArnSyncLogin.cpp \
+        $$PWD/ArnSyncShm.cpp
 
     HEADERS += \
         $$PWD/ArnInc/ArnClient.hpp \
@@ -92,6 +93,7 @@ contains(ARN, client) {
         $$PWD/ArnInc/ArnMonEvent.hpp \
         $$PWD/ArnSync.hpp \
         $$PWD/ArnSyncLogin.hpp \
+        $$PWD/ArnSyncShm.hpp \
         $$PWD/private/ArnClient_p.hpp \
         $$PWD/private/ArnDepend_p.hpp \
         $$PWD/private/ArnRpc_p.hpp \
@@ -105,6 +107,13 @@ ArnRealFloat {
 }
 
 
+ArnZlib {
+    DEFINES += ARN_ZLIB  # Compression of sync traffic, needs zlib
+    win32: LIBS += -lzlib
+    else:  LIBS += -lz
+}
+
+
 contains(ARN, scriptauto) {
     lessThan(QT_MAJOR_VERSION, 5) | lessThan(QT_MAJOR_VERSION, 6):lessThan(QT_MINOR_VERSION, 14) {
         ARN += script
@@ -32,26 +32,89 @@
 #include "ArnLink.hpp"
 #include "ArnInc/ArnLib.hpp"
 #include "ArnInc/ArnEvent.hpp"
+#include "ArnInc/ArnBasicItem.hpp"
 #include <QCoreApplication>
 #include <QThread>
+#include <QThreadStorage>
 #include <limits>
 #include <QDebug>
 
+#if __cplusplus >= 201103L || (__cplusplus < 200000 && __cplusplus > 199711L)
+// Use lock-free read of Int and Real values in threaded links
+#  include <atomic>
+#  define ARNLINK_SEQLOCK
+#endif
+
+// Folders with at least this number of children get a hashed name index
+#define CHILDINDEX_MIN  32
+
 QAtomicInt ArnLink::_idCount(1);
+QAtomicInt ArnLink::_transactionCount(0);
 
 
-struct ArnLinkValue {
+static QAtomicInt  countValueExt(0);
+
+
+struct ArnLinkValueExt {
     QString  valueString;
     QByteArray  valueByteArray;
     QVariant  valueVariant;
+};
+
+
+//// Numeric values are stored inline, other representations are only allocated when needed
+//// Not a union, int and real have own fields. ArnLink::_type tags the primary type.
+struct ArnLinkValue {
     volatile ARNREAL  valueReal;
     volatile int  valueInt;
     quint32  localUpdateCount;  // Also ignored updates (ignoreSameValue) are included
+    quint32  valueVersion;      // Changed by every value write, also from remote
+    QAtomicInt  valueSeq;       // Odd while type or value is written in a threaded link
+    ArnLinkValueExt*  extVal;
 
     ArnLinkValue() {
         valueReal = 0.0;
         valueInt  = 0;
         localUpdateCount = 0;
+        valueVersion     = 0;
+        extVal    = arnNullptr;
+    }
+
+    ~ArnLinkValue() {
+        dropExt();
+    }
+
+    ArnLinkValueExt*  ext() {
+        if (!extVal) {
+            extVal = new ArnLinkValueExt;
+            countValueExt.ref();
+        }
+        return extVal;
+    }
+
+    void  dropExt() {
+        if (!extVal)  return;
+        delete extVal;
+        extVal = arnNullptr;
+        countValueExt.deref();
+    }
+};
+
+
+//// Value changes collected during a transaction, one notification per link
+struct ArnLinkTransaction {
+    struct Rec {
+        ArnLink*  link;
+        int  sendId;
+        ArnLinkHandle*  handleData;
+    };
+
+    int  depth;
+    QList<Rec>  recs;
+    QHash<ArnLink*,int>  recIndex;
+
+    ArnLinkTransaction() {
+        depth = 0;
     }
 };
 
@@ -71,10 +134,13 @@ ArnLink::ArnLink( ArnLink *parent, const QString& name, Arn::LinkFlags flags)
     _subscribeTab    = arnNullptr;
     _mutex           = arnNullptr;
     _children        = _isFolder ? new ArnLinkList : &nullArnLinkList;
+    _childIndex      = arnNullptr;
     _val             = _isFolder ? arnNullptr : new ArnLinkValue;
     _isPipeMode      = false;
     _isSaveMode      = false;
     _hasBeenSetup    = false;
+    _isPathCached    = false;
+    _isReclaimQueued = false;
     _syncMode        = 0;
     _id              = quint32( _idCount.fetchAndAddRelaxed(1));
     _refCount        = -1;  // Mark no reference, Ok to delete
@@ -101,6 +167,10 @@ ArnLink::~ArnLink()
     }
 
     setParent( arnNullptr);
+    if (_childIndex)
+        delete _childIndex;
+    if (_val)
+        delete _val;
 }
 
 
@@ -114,6 +184,53 @@ void  ArnLink::resetHave()
 }
 
 
+//// Writers hold the mutex, the sequence only lets lock-free readers detect an ongoing write
+void  ArnLink::seqWriteBegin()
+{
+    if (_mutex)  _val->valueSeq.fetchAndAddOrdered(1);
+}
+
+
+void  ArnLink::seqWriteEnd()
+{
+    if (_mutex)  _val->valueSeq.fetchAndAddOrdered(1);
+}
+
+
+bool  ArnLink::seqReadInt( int& value)
+{
+#ifdef ARNLINK_SEQLOCK
+    if (Arn::offLockFreeRead)  return false;
+
+    int  seq = _val->valueSeq.loadAcquire();
+    if ((seq & 1)  ||  (_type != Arn::DataType::Int))  return false;
+    value = _val->valueInt;
+    std::atomic_thread_fence( std::memory_order_acquire);
+    return _val->valueSeq.loadAcquire() == seq;
+#else
+    Q_UNUSED(value)
+    return false;
+#endif
+}
+
+
+bool  ArnLink::seqReadReal( ARNREAL& value)
+{
+#ifdef ARNLINK_SEQLOCK
+    if (Arn::offLockFreeRead)  return false;
+
+    int  seq = _val->valueSeq.loadAcquire();
+    if ((seq & 1)  ||  (_type != Arn::DataType::Real))  return false;
+    value = _val->valueReal;
+    std::atomic_thread_fence( std::memory_order_acquire);
+    return _val->valueSeq.loadAcquire() == seq;
+#else
+    Q_UNUSED(value)
+    return false;
+#endif
+}
+
+
 void  ArnLink::needInt( bool* isOk)
 {
     if (!_haveInt) {
@@ -123,13 +240,13 @@ void  ArnLink::needInt( bool* isOk)
             _val->valueInt = int( _val->valueReal);
             break;
         case Arn::DataType::String:
-            _val->valueInt = _val->valueString.toInt( &isOk2);
+            _val->valueInt = _val->ext()->valueString.toInt( &isOk2);
             break;
         case Arn::DataType::ByteArray:
-            _val->valueInt = _val->valueByteArray.toInt( &isOk2);
+            _val->valueInt = _val->ext()->valueByteArray.toInt( &isOk2);
             break;
         case Arn::DataType::Variant:
-            _val->valueInt = _val->valueVariant.toInt( &isOk2);
+            _val->valueInt = _val->ext()->valueVariant.toInt( &isOk2);
             break;
         default:
             _val->valueInt = 0;
@@ -152,23 +269,23 @@ void  ArnLink::needReal( bool* isOk)
             break;
 #if defined( ARNREAL_FLOAT)
         case Arn::DataType::String:
-            _val->valueReal = _val->valueString.toFloat( &isOk2);
+            _val->valueReal = _val->ext()->valueString.toFloat( &isOk2);
             break;
         case Arn::DataType::ByteArray:
-            _val->valueReal = _val->valueByteArray.toFloat( &isOk2);
+            _val->valueReal = _val->ext()->valueByteArray.toFloat( &isOk2);
             break;
         case Arn::DataType::Variant:
-            _val->valueReal = _val->valueVariant.toFloat( &isOk2);
+            _val->valueReal = _val->ext()->valueVariant.toFloat( &isOk2);
             break;
 #else
         case Arn::DataType::String:
-            _val->valueReal = _val->valueString.toDouble( &isOk2);
+            _val->valueReal = _val->ext()->valueString.toDouble( &isOk2);
             break;
         case Arn::DataType::ByteArray:
-            _val->valueReal = _val->valueByteArray.toDouble( &isOk2);
+            _val->valueReal = _val->ext()->valueByteArray.toDouble( &isOk2);
             break;
         case Arn::DataType::Variant:
-            _val->valueReal = _val->valueVariant.toDouble( &isOk2);
+            _val->valueReal = _val->ext()->valueVariant.toDouble( &isOk2);
             break;
 #endif
         default:
@@ -196,13 +313,46 @@ ArnLink*  ArnLink::parent()  const
 
 void  ArnLink::setParent( ArnLink* parent)
 {
-    if (_parent)
+    if (_parent) {
         _parent->_children->removeOne( this);
+        _parent->removeChildIndex( this);
+    }
 
     _parent = parent;
 
-    if (_parent)
+    if (_parent) {
        _parent->_children->append( this);
+       _parent->addChildIndex( this);
+    }
+}
+
+
+void  ArnLink::addChildIndex( ArnLink* child)
+{
+    if (_childIndex) {
+        _childIndex->insert( child->_objectName, child);
+        return;
+    }
+    if (_children->size() < CHILDINDEX_MIN)  return;  // Small folder, the list is cheap enough
+
+    //// Folder has grown, build the index from all existing children
+    _childIndex = new ArnLinkIndex;
+    _childIndex->reserve( _children->size() * 2);
+    int  childNum = _children->size();
+    for (int i = 0; i < childNum; ++i) {
+        ArnLink*  link = _children->at(i);
+        _childIndex->insert( link->_objectName, link);
+    }
+}
+
+
+void  ArnLink::removeChildIndex( ArnLink* child)
+{
+    if (!_childIndex)  return;
+
+    ArnLinkIndex::iterator  i = _childIndex->find( child->_objectName);
+    if ((i != _childIndex->end()) && (i.value() == child))
+        _childIndex->erase( i);
 }
 
 
@@ -218,11 +368,102 @@ void  ArnLink::doValueChanged( int sendId, const QByteArray* valueData,
 {
     // qDebug() << "doValueChanged: isThr=" << (_mutex != arnNullptr)  << " isPipe=" << _isPipeMode <<
     //             " path=" << linkPath() << " value=" << (valueData ? *valueData : toByteArray());
+    if (!_isPipeMode && _transactionCount.loadAcquire()) {  // Pipes are streams, never deferred
+        ArnLinkTransaction*  trans = threadTransaction();
+        if (trans->depth > 0) {
+            int  recIdx = trans->recIndex.value( this, -1);
+            if (recIdx >= 0) {  // Already changed in this transaction, only last change is notified
+                ArnLinkTransaction::Rec&  rec = trans->recs[ recIdx];
+                delete rec.handleData;
+                rec.sendId     = sendId;
+                rec.handleData = new ArnLinkHandle( handleData);
+                return;
+            }
+
+            ArnLinkTransaction::Rec  rec;
+            rec.link       = this;
+            rec.sendId     = sendId;
+            rec.handleData = new ArnLinkHandle( handleData);
+            ref();  // Caller holds a reference, keep link until notified
+            trans->recIndex.insert( this, trans->recs.size());
+            trans->recs += rec;
+            return;
+        }
+    }
+
     ArnEvValueChange ev( sendId, valueData, handleData);
     sendArnEvent( &ev);
 }
 
 
+ArnLinkTransaction*  ArnLink::threadTransaction()
+{
+    static QThreadStorage<ArnLinkTransaction*>  transactions;
+
+    if (!transactions.hasLocalData())
+        transactions.setLocalData( new ArnLinkTransaction);
+    return transactions.localData();
+}
+
+
+void  ArnLink::beginTransaction()
+{
+    ArnLinkTransaction*  trans = threadTransaction();
+    if (trans->depth++ == 0)
+        _transactionCount.ref();
+}
+
+
+/// Unique id for notifications belonging together, also used by remote sync
+uint  ArnLink::newBatchId()
+{
+    static QAtomicInt  batchIdCount(0);
+
+    uint  batchId;
+    do {
+        batchId = uint( batchIdCount.fetchAndAddRelaxed(1) + 1);
+    } while (batchId == 0);  // 0 is reserved for no batch
+    return batchId;
+}
+
+
+/// Values are already written, all collected changes are notified with a common batch id
+bool  ArnLink::endTransaction()
+{
+    ArnLinkTransaction*  trans = threadTransaction();
+    if (trans->depth <= 0)  return false;  // No open transaction
+    if (--trans->depth > 0)  return true;  // Nested, outermost end will notify
+
+    _transactionCount.deref();
+
+    QList<ArnLinkTransaction::Rec>  recs;
+    recs.swap( trans->recs);
+    trans->recIndex.clear();
+
+    int  recNum = recs.size();
+    uint  batchId = (recNum > 1) ? newBatchId() : 0;
+
+    for (int i = 0; i < recNum; ++i) {
+        const ArnLinkTransaction::Rec&  rec = recs.at(i);
+        if (batchId)
+            rec.handleData->add( ArnLinkHandle::Batch, QVariant( batchId));
+        ArnEvValueChange  ev( rec.sendId, arnNullptr, *rec.handleData);
+        rec.link->sendArnEvent( &ev);
+        delete rec.handleData;
+        rec.link->deref();
+    }
+    return true;
+}
+
+
+bool  ArnLink::isTransaction()
+{
+    if (!_transactionCount.loadAcquire())  return false;
+
+    return threadTransaction()->depth > 0;
+}
+
+
 void  ArnLink::sendEventsInThread( ArnEvent* ev, const ArnCoreItemList& recipients)
 {
     int  len = recipients.size();
@@ -250,13 +491,35 @@ void  ArnLink::sendArnEvent( ArnEvent* ev)
     QThread*  curThread = QThread::currentThread();
 
     if (_subscribeTab && !_subscribeTab->isEmpty()) {
+        QList<QThread*>  alienThreads;
+        QList<ArnCoreItemList>  subscrAlien;
         foreach (ArnCoreItem* coreItem, *_subscribeTab) {
-            if (coreItem->thread() == curThread) {
+            QThread*  itemThread = coreItem->thread();
+            if (itemThread == curThread) {
                 subscrInThread += coreItem;
+                continue;
             }
-            else {
-                // Recipient in different thread
-                ArnEvent*  evClone = ev->makeHeapClone();
+            // Recipient in different thread
+            int  threadIdx = alienThreads.indexOf( itemThread);
+            if (threadIdx < 0) {
+                threadIdx = alienThreads.size();
+                alienThreads += itemThread;
+                subscrAlien  += ArnCoreItemList();
+            }
+            subscrAlien[ threadIdx] += coreItem;
+        }
+
+        int  threadNum = alienThreads.size();
+        for (int i = 0; i < threadNum; ++i) {
+            // One clone per recipient thread, fanned out by the threads common event handler
+            ArnEvent*  evClone = ev->makeHeapClone();
+            if (ArnBasicItemEventHandler::postBatch( alienThreads.at(i), evClone, subscrAlien.at(i)))
+                continue;
+
+            //// No common event handler in recipient thread, one event per recipient
+            delete evClone;
+            foreach (ArnCoreItem* coreItem, subscrAlien.at(i)) {
+                evClone = ev->makeHeapClone();
                 coreItem->sendArnEventItem( evClone, true, true);
             }
         }
@@ -307,11 +570,14 @@ void  ArnLink::setValue( int value, int sendId, bool useUncrossed)
     }
 
     if (_mutex)  _mutex->lock();
+    seqWriteBegin();
     resetHave();
     _val->valueInt = value;
     _type          = Arn::DataType::Int;
     _haveInt       = true;
+    ++_val->valueVersion;
     ++_val->localUpdateCount;
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_mutex && _isPipeMode) {
@@ -334,11 +600,14 @@ void  ArnLink::setValue( ARNREAL value, int sendId, bool useUncrossed)
     }
 
     if (_mutex)  _mutex->lock();
+    seqWriteBegin();
     resetHave();
     _val->valueReal = value;
     _type           = Arn::DataType::Real;
     _haveReal       = true;
+    ++_val->valueVersion;
     ++_val->localUpdateCount;
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_mutex && _isPipeMode) {
@@ -367,13 +636,16 @@ void  ArnLink::setValue( const QString& value, int sendId, bool useUncrossed,
     }
 
     if (_mutex)  _mutex->lock();
+    seqWriteBegin();
     resetHave();
-    _val->valueString.resize(0);     // Avoid heap defragmentation
-    _val->valueString += value;
+    _val->ext()->valueString.resize(0);     // Avoid heap defragmentation
+    _val->ext()->valueString += value;
     _type              = Arn::DataType::String;
     _haveString        = true;
+    ++_val->valueVersion;
     if (!handleData.flags().is( ArnLinkHandle::Flags::FromRemote))
         ++_val->localUpdateCount;
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_mutex && (_isPipeMode || !handleData.isNull())) {
@@ -397,13 +669,16 @@ void  ArnLink::setValue( const QByteArray& value, int sendId, bool useUncrossed,
     }
 
     if (_mutex)  _mutex->lock();
+    seqWriteBegin();
     resetHave();
-    _val->valueByteArray.resize(0);     // Avoid heap defragmentation
-    _val->valueByteArray += value;
+    _val->ext()->valueByteArray.resize(0);     // Avoid heap defragmentation
+    _val->ext()->valueByteArray += value;
     _type                 = Arn::DataType::ByteArray;
     _haveByteArray        = true;
+    ++_val->valueVersion;
     if (!handleData.flags().is( ArnLinkHandle::Flags::FromRemote))
         ++_val->localUpdateCount;
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_mutex && (_isPipeMode || !handleData.isNull())) {
@@ -426,12 +701,15 @@ void  ArnLink::setValue( const QVariant& value, int sendId, bool useUncrossed,
     }
 
     if (_mutex)  _mutex->lock();
+    seqWriteBegin();
     resetHave();
-    _val->valueVariant = value;
+    _val->ext()->valueVariant = value;
     _type              = Arn::DataType::Variant;
     _haveVariant       = true;
+    ++_val->valueVersion;
     if (!handleData.flags().is( ArnLinkHandle::Flags::FromRemote))
         ++_val->localUpdateCount;
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_mutex && _isPipeMode) {
@@ -478,13 +756,16 @@ void ArnLink::setBits( int mask, int value, int sendId, bool useUncrossed)
     if (_mutex)  _mutex->lock();
     needInt();
 
+    seqWriteBegin();
     resetHave();
     int  newValue  = (_val->valueInt & ~mask) | (value & mask);
     _val->valueInt = newValue;
     _type          = Arn::DataType::Int;
     _haveInt       = true;
+    ++_val->valueVersion;
     ++_val->localUpdateCount;
 
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_twin && !useUncrossed) {  // Update the OpProvider link before, as if it was requested there first
@@ -523,13 +804,16 @@ void ArnLink::addValue( int value, int sendId, bool useUncrossed)
     if (_mutex)  _mutex->lock();
     needInt();
 
+    seqWriteBegin();
     resetHave();
     int  newValue  = _val->valueInt + value;
     _val->valueInt = newValue;
     _type          = Arn::DataType::Int;
     _haveInt       = true;
+    ++_val->valueVersion;
     ++_val->localUpdateCount;
 
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_twin && !useUncrossed) {  // Update the OpProvider link before, as if it was requested there first
@@ -568,13 +852,16 @@ void  ArnLink::addValue( ARNREAL value, int sendId, bool useUncrossed)
     if (_mutex)  _mutex->lock();
     needReal();
 
+    seqWriteBegin();
     resetHave();
     ARNREAL  newValue = _val->valueReal + value;
     _val->valueReal   = newValue;
     _type             = Arn::DataType::Real;
     _haveReal         = true;
+    ++_val->valueVersion;
     ++_val->localUpdateCount;
 
+    seqWriteEnd();
     if (_mutex)  _mutex->unlock();
 
     if (_twin && !useUncrossed) {  // Update the OpProvider link before, as if it was requested there first
@@ -597,7 +884,11 @@ int  ArnLink::toInt( bool* isOk)
     if (isOk)
         *isOk = true;  // Default
     if (!_val)  return 0;
-    if (_mutex)  _mutex->lock();
+    if (_mutex) {
+        int  retVal;
+        if (seqReadInt( retVal))  return retVal;
+        _mutex->lock();
+    }
 
     needInt( isOk);
 
@@ -615,7 +906,11 @@ ARNREAL  ArnLink::toReal( bool* isOk)
     if (isOk)
         *isOk = true;  // Default
     if (!_val)  return 0.0;
-    if (_mutex)  _mutex->lock();
+    if (_mutex) {
+        ARNREAL  retVal;
+        if (seqReadReal( retVal))  return retVal;
+        _mutex->lock();
+    }
 
     needReal( isOk);
 
@@ -637,24 +932,24 @@ QString  ArnLink::toString( bool* isOk)
 
     if (!_haveString) {
         bool  isOk2 = true;  // Default
-        _val->valueString.resize(0);     // Avoid heap defragmentation
+        _val->ext()->valueString.resize(0);     // Avoid heap defragmentation
         switch (_type) {
         case Arn::DataType::Int:
-            _val->valueString += QString::number(_val->valueInt, 10);
+            _val->ext()->valueString += QString::number(_val->valueInt, 10);
             break;
         case Arn::DataType::Real:
 #if defined( ARNREAL_FLOAT)
-            _val->valueString += QString::number(_val->valueReal, 'g', std::numeric_limits<float>::digits10);
+            _val->ext()->valueString += QString::number(_val->valueReal, 'g', std::numeric_limits<float>::digits10);
 #else
-            _val->valueString += QString::number(_val->valueReal, 'g', std::numeric_limits<double>::digits10);
+            _val->ext()->valueString += QString::number(_val->valueReal, 'g', std::numeric_limits<double>::digits10);
 #endif
             break;
         case Arn::DataType::ByteArray:
-            _val->valueString += QString::fromUtf8( _val->valueByteArray.constData(), _val->valueByteArray.size());
+            _val->ext()->valueString += QString::fromUtf8( _val->ext()->valueByteArray.constData(), _val->ext()->valueByteArray.size());
             break;
         case Arn::DataType::Variant:
-            isOk2 = _val->valueVariant.canConvert( QVariant::String);
-            _val->valueString += _val->valueVariant.toString();
+            isOk2 = _val->ext()->valueVariant.canConvert( QVariant::String);
+            _val->ext()->valueString += _val->ext()->valueVariant.toString();
             break;
         default:
             isOk2 = false;
@@ -665,11 +960,11 @@ QString  ArnLink::toString( bool* isOk)
     }
 
     if (_mutex) {
-        QString retVal = _val->valueString;
+        QString retVal = _val->ext()->valueString;
         _mutex->unlock();
         return retVal;
     }
-    return _val->valueString;
+    return _val->ext()->valueString;
 }
 
 
@@ -682,24 +977,24 @@ QByteArray  ArnLink::toByteArray( bool* isOk)
 
     if (!_haveByteArray) {
         bool  isOk2 = true;  // Default
-        _val->valueByteArray.resize(0);     // Avoid heap defragmentation
+        _val->ext()->valueByteArray.resize(0);     // Avoid heap defragmentation
         switch (_type) {
         case Arn::DataType::Int:
-            _val->valueByteArray += QByteArray::number( _val->valueInt, 10);
+            _val->ext()->valueByteArray += QByteArray::number( _val->valueInt, 10);
             break;
         case Arn::DataType::Real:
 #if defined( ARNREAL_FLOAT)
-            _val->valueByteArray += QByteArray::number( _val->valueReal, 'g', std::numeric_limits<float>::digits10);
+            _val->ext()->valueByteArray += QByteArray::number( _val->valueReal, 'g', std::numeric_limits<float>::digits10);
 #else
-            _val->valueByteArray += QByteArray::number( _val->valueReal, 'g', std::numeric_limits<double>::digits10);
+            _val->ext()->valueByteArray += QByteArray::number( _val->valueReal, 'g', std::numeric_limits<double>::digits10);
 #endif
             break;
         case Arn::DataType::String:
-            _val->valueByteArray += _val->valueString.toUtf8();
+            _val->ext()->valueByteArray += _val->ext()->valueString.toUtf8();
             break;
         case Arn::DataType::Variant:
-            isOk2 = _val->valueVariant.canConvert( QVariant::String);
-            _val->valueByteArray += _val->valueVariant.toString().toUtf8();
+            isOk2 = _val->ext()->valueVariant.canConvert( QVariant::String);
+            _val->ext()->valueByteArray += _val->ext()->valueVariant.toString().toUtf8();
             break;
         default:
             isOk2 = false;
@@ -710,11 +1005,11 @@ QByteArray  ArnLink::toByteArray( bool* isOk)
     }
 
     if (_mutex) {
-        QByteArray retVal = _val->valueByteArray;
+        QByteArray retVal = _val->ext()->valueByteArray;
         _mutex->unlock();
         return retVal;
     }
-    return _val->valueByteArray;
+    return _val->ext()->valueByteArray;
 }
 
 
@@ -729,20 +1024,20 @@ QVariant  ArnLink::toVariant( bool* isOk)
         bool  isOk2 = true;  // Default
         switch (_type) {
         case Arn::DataType::Int:
-            _val->valueVariant = _val->valueInt;
+            _val->ext()->valueVariant = _val->valueInt;
             break;
         case Arn::DataType::Real:
-            _val->valueVariant = _val->valueReal;
+            _val->ext()->valueVariant = _val->valueReal;
             break;
         case Arn::DataType::String:
-            _val->valueVariant = _val->valueString;
+            _val->ext()->valueVariant = _val->ext()->valueString;
             break;
         case Arn::DataType::ByteArray:
-            _val->valueVariant = QString::fromUtf8( _val->valueByteArray.constData(),
-                                                    _val->valueByteArray.size());
+            _val->ext()->valueVariant = QString::fromUtf8( _val->ext()->valueByteArray.constData(),
+                                                    _val->ext()->valueByteArray.size());
             break;
         default:
-            _val->valueVariant = QVariant();
+            _val->ext()->valueVariant = QVariant();
             isOk2 = false;
         }
         _haveVariant = isOk2;
@@ -751,11 +1046,65 @@ QVariant  ArnLink::toVariant( bool* isOk)
     }
 
     if (_mutex) {
-        QVariant retVal = _val->valueVariant;
+        QVariant retVal = _val->ext()->valueVariant;
         _mutex->unlock();
         return retVal;
     }
-    return _val->valueVariant;
+    return _val->ext()->valueVariant;
+}
+
+
+//// Drop cached representations that can be regenerated from the primary value
+void  ArnLink::dropValueCache()
+{
+    if (!_val)  return;
+    if (_mutex)  _mutex->lock();
+
+    switch (_type) {
+    case Arn::DataType::String:
+        if (_haveByteArray)  _val->ext()->valueByteArray = QByteArray();
+        if (_haveVariant)    _val->ext()->valueVariant   = QVariant();
+        _haveByteArray = false;
+        _haveVariant   = false;
+        break;
+    case Arn::DataType::ByteArray:
+        if (_haveString)   _val->ext()->valueString  = QString();
+        if (_haveVariant)  _val->ext()->valueVariant = QVariant();
+        _haveString  = false;
+        _haveVariant = false;
+        break;
+    case Arn::DataType::Variant:
+        if (_haveString)     _val->ext()->valueString    = QString();
+        if (_haveByteArray)  _val->ext()->valueByteArray = QByteArray();
+        _haveString    = false;
+        _haveByteArray = false;
+        break;
+    default:  // Numeric (or no) value, nothing in extended storage is needed
+        _val->dropExt();
+        _haveString    = false;
+        _haveByteArray = false;
+        _haveVariant   = false;
+    }
+
+    if (_mutex)  _mutex->unlock();
+}
+
+
+int  ArnLink::valueSizeBase()
+{
+    return int( sizeof( ArnLinkValue));
+}
+
+
+int  ArnLink::valueSizeExt()
+{
+    return int( sizeof( ArnLinkValueExt));
+}
+
+
+int  ArnLink::valueExtCount()
+{
+    return countValueExt;
 }
 
 
@@ -830,6 +1179,9 @@ ArnLink*  ArnLink::findLink( const QString& name)
 {
     QString  name_ = Arn::convertBaseName( name, Arn::NameF());
 
+    if (_childIndex)
+        return _childIndex->value( name_, arnNullptr);
+
     int  childNum = _children->size();
     for (int i = 0; i < childNum; i++) {
         ArnLink*  child = _children->at(i);
@@ -1006,6 +1358,16 @@ QObject*  ArnLink::arnM( QObject* inArnM)
 }
 
 
+//// Write locked by main thread when links are created, retired or deleted.
+//// Read locked by other threads walking the tree, see ArnM::linkThreadFind()
+QReadWriteLock*  ArnLink::treeLock()
+{
+    static QReadWriteLock  lock;
+
+    return &lock;
+}
+
+
 bool  ArnLink::isRetired()
 {
     if (_mutex)  _mutex->lock();
@@ -1097,17 +1459,6 @@ QString  ArnLink::twinName()
 }
 
 
-/// Can only be called from main-thread
-void  ArnLink::setRefCount( int count)
-{
-    ArnLink*  vLink = valueLink();
-
-    if (vLink->_mutex)  vLink->_mutex->lock();
-    vLink->_refCount = count;
-    if (vLink->_mutex)  vLink->_mutex->unlock();
-}
-
-
 void  ArnLink::decZeroRefs()
 {
     int  zeroRefCount = 0;
@@ -1124,13 +1475,17 @@ void  ArnLink::decZeroRefs()
 }
 
 
-bool  ArnLink::isLastZeroRef()
+/// Can only be called from main-thread
+/// Mark link as fully de-referenced if this is the last zeroRef, checked and set as one
+/// operation, i.e. no thread can take a reference in between, see refIfInUse()
+bool  ArnLink::setFullyDerefIfLast()
 {
-    bool  retVal    = false;
     ArnLink*  vLink = valueLink();
 
     if (vLink->_mutex)  vLink->_mutex->lock();
-    retVal = (vLink->_refCount == 0) && (vLink->_zeroRefCount == 0);
+    bool  retVal = (vLink->_refCount == 0) && (vLink->_zeroRefCount == 0);
+    if (retVal)
+        vLink->_refCount = -1;
     if (vLink->_mutex)  vLink->_mutex->unlock();
 
     return retVal;
@@ -1152,6 +1507,33 @@ void  ArnLink::ref()
 }
 
 
+/// Can be called from any thread with treeLock() read locked on a threaded link
+/// Only adds to existing references, an unreferenced link is left to the main-thread
+bool  ArnLink::refIfInUse()
+{
+    ArnLink*  vLink = valueLink();
+
+    if (vLink->_mutex)  vLink->_mutex->lock();
+    bool  retVal = vLink->_refCount > 0;
+    if (retVal)
+        vLink->_refCount++;
+    if (vLink->_mutex)  vLink->_mutex->unlock();
+    if (retVal && Arn::debugLinkRef)  qDebug() << "link-ref: path=" << this->linkPath() << " count=" << refCount();
+
+    return retVal;
+}
+
+
+bool  ArnLink::hasSubscriber()
+{
+    if (_mutex)  _mutex->lock();
+    bool  retVal = _subscribeTab && !_subscribeTab->isEmpty();
+    if (_mutex)  _mutex->unlock();
+
+    return retVal;
+}
+
+
 bool  ArnLink::subscribe( ArnCoreItem* subscriber)
 {
     if (!subscriber)  return false;  // Not valid subscriber
@@ -1228,3 +1610,16 @@ quint32 ArnLink::localUpdateCount()
 
     return retVal;
 }
+
+
+quint32  ArnLink::valueVersion()
+{
+    quint32  retVal = 0;
+
+    if (_mutex)  _mutex->lock();
+    if (_val)
+        retVal = _val->valueVersion;
+    if (_mutex)  _mutex->unlock();
+
+    return retVal;
+}
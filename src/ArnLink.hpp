@@ -42,12 +42,16 @@
 #include <QVariant>
 #include <QAtomicInt>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QHash>
 
 struct ArnLinkValue;
+struct ArnLinkTransaction;
 class ArnEvent;
 class ArnLink;
 
 typedef QList<ArnLink*>  ArnLinkList;
+typedef QHash<QString,ArnLink*>  ArnLinkIndex;
 typedef QList<ArnCoreItem*>  ArnCoreItemList;
 
 
@@ -90,6 +94,10 @@ public:
     QVariant  toVariant( bool* isOk = arnNullptr);
 
     Arn::DataType  type();
+    void  dropValueCache();
+    static int  valueSizeBase();
+    static int  valueSizeExt();
+    static int  valueExtCount();
 
     QString  linkPath( Arn::NameF nameF = Arn::NameF::EmptyOk);
     QString  linkName( Arn::NameF nameF = Arn::NameF());
@@ -121,6 +129,7 @@ public:
     void  deref();
     int  refCount();
     quint32 localUpdateCount();
+    quint32  valueVersion();
 
     QString  objectName()  const;
     ArnLink*  parent()  const;
@@ -128,29 +137,43 @@ public:
 
     QMutex*  getMutex()  const;
 
+    //// Value change notifications in this thread are deferred until the outermost end
+    static void  beginTransaction();
+    static bool  endTransaction();
+    static bool  isTransaction();
+    static uint  newBatchId();
+
 
 protected:
     //// Will never be inherited, this section is separated for use by friend ArnM
     ArnLink( ArnLink* parent, const QString& name, Arn::LinkFlags flags);
     void  setupEnd( const QString& path, Arn::ObjectSyncMode syncMode, Arn::LinkFlags flags);
     void  setParent( ArnLink* parent);
+    void  addChildIndex( ArnLink* child);
+    void  removeChildIndex( ArnLink* child);
     void  doModeChanged();
     ArnLink*  findLink( const QString& name);
     void  ref();
-    void  setRefCount( int count);
+    bool  refIfInUse();
     void  decZeroRefs();
-    bool  isLastZeroRef();
+    bool  setFullyDerefIfLast();
     void  setRetired( RetireType retireType);
     void  doRetired( ArnLink* startLink, bool isGlobal);
     void  setThreaded();  // Only used in main thread
+    bool  hasSubscriber();
     void  lock();
     void  unlock();
     static QObject*  arnM( QObject* inArnM = arnNullptr);
+    static QReadWriteLock*  treeLock();
 
     ArnLink*  _twin;   // Used for bidirectional functionality
 
 private:
     void  resetHave();
+    void  seqWriteBegin();
+    void  seqWriteEnd();
+    bool  seqReadInt( int& value);
+    bool  seqReadReal( ARNREAL& value);
     void  needInt( bool* isOk = arnNullptr);
     void  needReal( bool* isOk = arnNullptr);
     void  doValueChanged( int sendId, const QByteArray* valueData = arnNullptr,
@@ -158,9 +181,12 @@ private:
     void  sendEventsInThread( ArnEvent* ev, const ArnCoreItemList& recipients);
     void  sendEventsDirRoot( ArnEvent* ev, ArnLink* startLink);
     void  sendEventArnM( ArnEvent* ev);
+    static ArnLinkTransaction*  threadTransaction();
 
     // Source for unique id to all ArnLink ..
     static QAtomicInt  _idCount;
+    // Number of threads having an open transaction
+    static QAtomicInt  _transactionCount;
 
     QMutex*  _mutex;
     ArnLinkValue*  _val;
@@ -168,6 +194,7 @@ private:
     ArnLink*  _parent;
     QString  _objectName;
     ArnLinkList*  _children;
+    ArnLinkIndex*  _childIndex;  // Only used for folders with many children
 
     quint32  _id;
     volatile qint32  _refCount;
@@ -177,10 +204,14 @@ private:
     volatile quint8  _type;
     volatile quint8  _zeroRefCount;
 
-    bool  _hasBeenSetup : 1;
-    bool  _isFolder : 1;
-    bool  _isProvider : 1;
-    bool  _isAtomicOpProvider : 1;
+    bool  _isFolder : 1;    // Constant after construction, read by threads in ArnM
+    bool  _isProvider : 1;  // Constant after construction, read by threads in ArnM
+
+    //// Written without lock, not bit fields as they must not share memory with other flags
+    volatile bool  _hasBeenSetup;
+    bool  _isAtomicOpProvider;
+    bool  _isPathCached;     // Main thread only, see ArnM path cache
+    bool  _isReclaimQueued;  // Main thread only, deleted by ArnM reclaim, not by zero-ref
 
     volatile bool  _isPipeMode : 1;
     volatile bool  _isSaveMode : 1;
@@ -34,6 +34,7 @@
 #include "ArnInc/ArnEvent.hpp"
 #include "ArnLink.hpp"
 #include <QMutex>
+#include <QReadWriteLock>
 #include <QWaitCondition>
 #include <QThreadStorage>
 #include <QThread>
@@ -43,12 +44,118 @@
 #include <QMetaEnum>
 #include <QFile>
 #include <QDir>
+#include <QDataStream>
+#include <QtEndian>
 #include <iostream>
 #include <QTimer>
 #include <QDateTime>
 #include <QStringList>
 #include <QVector>
 #include <QDebug>
+#include <string.h>
+
+#define PATHCACHE_MAX  100000
+// Max number of retired links deleted per main-thread event
+#define RECLAIM_BATCH  10000
+
+// Snapshot file: magic, then records in tree order, all numbers little endian
+//   'F' name syncMode                              Folder start
+//   'E'                                            Folder end
+//   'L' name syncMode modeBits type dataLen data   Leaf
+// name is u16 length and utf8
+#define SNAPSHOT_MAGIC     "ArnSnap1"
+#define SNAPSHOT_FLUSHSIZE  (1 << 20)
+#define SNAPMODE_PIPE      0x01
+#define SNAPMODE_SAVE      0x02
+#define SNAPMODE_ATOMICOP  0x04
+
+
+/////////////// Snapshot coding
+
+static void  snapPutU16( QByteArray& buf, quint16 val)
+{
+    uchar  tmp[2];
+    qToLittleEndian<quint16>( val, tmp);
+    buf.append( reinterpret_cast<const char*>( tmp), 2);
+}
+
+
+static void  snapPutU32( QByteArray& buf, quint32 val)
+{
+    uchar  tmp[4];
+    qToLittleEndian<quint32>( val, tmp);
+    buf.append( reinterpret_cast<const char*>( tmp), 4);
+}
+
+
+static void  snapPutData( QByteArray& buf, const QByteArray& data)
+{
+    snapPutU32( buf, quint32( data.size()));
+    buf += data;
+}
+
+
+//// Bounds checked reader of a mapped snapshot, any overrun makes it not Ok
+class ArnSnapReader
+{
+public:
+    ArnSnapReader( const uchar* data, qint64 size)
+    {
+        _pos  = data;
+        _end  = data + size;
+        _isOk = true;
+    }
+
+    bool  isOk()  const  {return _isOk;}
+    bool  atEnd()  const  {return _pos >= _end;}
+    void  setError()  {_isOk = false;}
+
+    int  getU8()
+    {
+        if (!has(1))  return 0;
+        return *_pos++;
+    }
+
+    quint32  getU32()
+    {
+        if (!has(4))  return 0;
+        quint32  val = qFromLittleEndian<quint32>( _pos);
+        _pos += 4;
+        return val;
+    }
+
+    QString  getName()
+    {
+        if (!has(2))  return QString();
+        int  len = qFromLittleEndian<quint16>( _pos);
+        _pos += 2;
+        if (!has( len))  return QString();
+        QString  name = QString::fromUtf8( reinterpret_cast<const char*>( _pos), len);
+        _pos += len;
+        return name;
+    }
+
+    QByteArray  getData()
+    {
+        quint32  len = getU32();
+        if (!has( len))  return QByteArray();
+        QByteArray  data( reinterpret_cast<const char*>( _pos), int( len));
+        _pos += len;
+        return data;
+    }
+
+private:
+    bool  has( qint64 len)
+    {
+        if (_isOk && (_end - _pos < len))
+            _isOk = false;
+        return _isOk;
+    }
+
+    const uchar*  _pos;
+    const uchar*  _end;
+    bool  _isOk;
+};
 
 
 /////////////// ArnThreadCom
@@ -138,10 +245,13 @@ ArnM::ArnM()
     _countFolderLink        = arnNullptr;
     _countLeafLink          = arnNullptr;
     _countRefLink           = arnNullptr;
+    _countValueExtLink      = arnNullptr;
+    _valueSizeLink          = arnNullptr;
     _timerMetrics           = new QTimer( this);
 
     _defaultIgnoreSameValue = false;
     _skipLocalSysLoading    = false;
+    _isReclaimPosted        = false;
     _isThreadedApp          = false;
     _mainThread             = QThread::currentThread();
     _root                   = new ArnLink( arnNullptr, "", Arn::LinkFlags::Folder);
@@ -217,6 +327,8 @@ void  ArnM::postSetup()
     _countFolderLink  = ArnM::link( metricPath + "ObjectFolders/value", Arn::LinkFlags::CreateAllowed);
     _countLeafLink    = ArnM::link( metricPath + "ObjectLeaves/value",  Arn::LinkFlags::CreateAllowed);
     _countRefLink     = ArnM::link( metricPath + "ObjectRef/value",     Arn::LinkFlags::CreateAllowed);
+    _countValueExtLink = ArnM::link( metricPath + "ObjectValueExt/value", Arn::LinkFlags::CreateAllowed);
+    _valueSizeLink    = ArnM::link( metricPath + "ObjectValueSize/value", Arn::LinkFlags::CreateAllowed);
     _timerMetrics->start( 5000);
     connect( _timerMetrics, SIGNAL(timeout()), this, SLOT(onTimerMetrics()));
     onTimerMetrics();
@@ -536,6 +648,35 @@ void  ArnM::setValue( const QString& path, const char* value)
 }
 
 
+void  ArnM::setValues( const QVariantMap& pathValues)
+{
+    ArnLink::beginTransaction();
+
+    QVariantMap::const_iterator  i;
+    for (i = pathValues.constBegin(); i != pathValues.constEnd(); ++i) {
+        const QVariant&  value = i.value();
+        switch (int( value.type())) {
+        case QMetaType::Int:
+            setValue( i.key(), value.toInt());
+            break;
+        case QMetaType::Double:
+            setValue( i.key(), ARNREAL( value.toDouble()));
+            break;
+        case QMetaType::QString:
+            setValue( i.key(), value.toString());
+            break;
+        case QMetaType::QByteArray:
+            setValue( i.key(), value.toByteArray());
+            break;
+        default:
+            setValue( i.key(), value);
+        }
+    }
+
+    ArnLink::endTransaction();
+}
+
+
 bool  ArnM::loadFromFile( const QString& path, const QString& fileName, Arn::Coding coding)
 {
     bool  isText = coding.is( coding.Text);
@@ -576,6 +717,285 @@ bool  ArnM::saveToFile( const QString& path, const QString& fileName, Arn::Codin
 }
 
 
+bool  ArnM::saveSnapshot( const QString& path, const QString& fileName)
+{
+    if (!isMainThread()) {
+        errorLog( QString(tr("Save snapshot, Path:")) + path, ArnError::NotMainThread);
+        return false;
+    }
+
+    QString  folderPath = Arn::fullPath( path);
+    if (!folderPath.endsWith("/"))
+        folderPath += "/";
+    ArnLink*  folder = linkMain( folderPath, Arn::LinkFlags::SilentError);
+    if (!folder) {
+        errorLog( QString(tr("Save snapshot, Path:")) + folderPath, ArnError::NotFound);
+        return false;
+    }
+
+    bool  isOk = false;
+    QFile  file( fileName);
+    if (file.open( QIODevice::WriteOnly)) {
+        QByteArray  buf( SNAPSHOT_MAGIC);
+        buf.reserve( SNAPSHOT_FLUSHSIZE + 1024);
+        isOk = true;
+        foreach (ArnLink* child, folder->children()) {
+            isOk = saveSnapshotLink( buf, file, child);
+            if (!isOk)  break;
+        }
+        isOk = isOk && (file.write( buf) == buf.size());
+    }
+
+    folder->deref();  // Ok, as this is main thread
+    return isOk;
+}
+
+
+bool  ArnM::saveSnapshotLink( QByteArray& buf, QIODevice& dev, ArnLink* link)
+{
+    if (link->isRetired())  return true;  // Not saved
+
+    QByteArray  name = link->objectName().toUtf8();
+    buf += link->isFolder() ? 'F' : 'L';
+    snapPutU16( buf, quint16( name.size()));
+    buf += name;
+    buf += char( link->syncMode().toInt());
+
+    if (link->isFolder()) {
+        foreach (ArnLink* child, link->children()) {
+            if (!saveSnapshotLink( buf, dev, child))  return false;
+        }
+        buf += 'E';
+    }
+    else {
+        int  modeBits = 0;
+        if (link->isPipeMode())          modeBits |= SNAPMODE_PIPE;
+        if (link->isSaveMode())          modeBits |= SNAPMODE_SAVE;
+        if (link->isAtomicOpProvider())  modeBits |= SNAPMODE_ATOMICOP;
+        buf += char( modeBits);
+
+        Arn::DataType  type = link->type();
+        buf += char( int( type));
+        switch (type) {
+        case Arn::DataType::Int:
+        {
+            QByteArray  data( 4, 0);
+            qToLittleEndian<qint32>( link->toInt(), reinterpret_cast<uchar*>( data.data()));
+            snapPutData( buf, data);
+            break;
+        }
+        case Arn::DataType::Real:
+        {
+            double  real = double( link->toReal());
+            quint64  realBits;
+            memcpy( &realBits, &real, sizeof(realBits));
+            QByteArray  data( 8, 0);
+            qToLittleEndian<quint64>( realBits, reinterpret_cast<uchar*>( data.data()));
+            snapPutData( buf, data);
+            break;
+        }
+        case Arn::DataType::String:
+            snapPutData( buf, link->toString().toUtf8());
+            break;
+        case Arn::DataType::ByteArray:
+            snapPutData( buf, link->toByteArray());
+            break;
+        case Arn::DataType::Variant:
+        {
+            QByteArray  data;
+            QDataStream  stream( &data, QIODevice::WriteOnly);
+            stream << link->toVariant();
+            snapPutData( buf, data);
+            break;
+        }
+        default:
+            snapPutU32( buf, 0);
+        }
+    }
+
+    if (buf.size() >= SNAPSHOT_FLUSHSIZE) {
+        if (dev.write( buf) != buf.size())  return false;
+        buf.resize(0);
+    }
+    return true;
+}
+
+
+bool  ArnM::loadSnapshot( const QString& path, const QString& fileName)
+{
+    if (!isMainThread()) {
+        errorLog( QString(tr("Load snapshot, Path:")) + path, ArnError::NotMainThread);
+        return false;
+    }
+
+    QFile  file( fileName);
+    if (!file.open( QIODevice::ReadOnly))  return false;
+
+    QByteArray  fileData;
+    qint64  fileSize = file.size();
+    const uchar*  data = (fileSize > 0) ? file.map( 0, fileSize) : arnNullptr;
+    if (!data) {  // Mapping not available, read all
+        fileData = file.readAll();
+        fileSize = fileData.size();
+        data     = reinterpret_cast<const uchar*>( fileData.constData());
+    }
+
+    int  magicSize = int( strlen( SNAPSHOT_MAGIC));
+    if ((fileSize < magicSize) || (memcmp( data, SNAPSHOT_MAGIC, size_t( magicSize)) != 0)) {
+        errorLog( QString(tr("Load snapshot bad file:")) + fileName, ArnError::CreateError);
+        return false;
+    }
+    ArnSnapReader  reader( data + magicSize, fileSize - magicSize);
+
+    QString  folderPath = Arn::fullPath( path);
+    if (!folderPath.endsWith("/"))
+        folderPath += "/";
+    ArnLink*  topFolder = linkMain( folderPath, Arn::LinkFlags::CreateAllowed);
+    if (!topFolder)  return false;
+
+    ArnLink*  folder = topFolder;  // Null when skipping a folder
+    bool  isNotify   = isSubscribedToRoot( topFolder);
+    QList<ArnLink*>  folderStack;
+    QList<bool>  notifyStack;
+
+    while (reader.isOk() && !reader.atEnd()) {
+        int  recType = reader.getU8();
+        if (recType == 'E') {
+            if (folderStack.isEmpty()) {
+                reader.setError();
+                break;
+            }
+            folder   = folderStack.takeLast();
+            isNotify = notifyStack.takeLast();
+            continue;
+        }
+
+        QString  name = reader.getName();
+        Arn::ObjectSyncMode  syncMode = Arn::ObjectSyncMode::fromInt( reader.getU8());
+        if (recType == 'F') {
+            folderStack += folder;
+            notifyStack += isNotify;
+            if (folder && reader.isOk())
+                folder = snapshotLink( folder, name, Arn::LinkFlags::Folder, syncMode, isNotify);
+            else
+                folder = arnNullptr;
+            if (folder && !isNotify)
+                isNotify = isSubscribedToRoot( folder);
+            continue;
+        }
+        if (recType != 'L') {
+            reader.setError();
+            break;
+        }
+
+        int  modeBits   = reader.getU8();
+        int  type       = reader.getU8();
+        QByteArray  val = reader.getData();
+        if (!reader.isOk() || !folder)  continue;
+
+        ArnLink*  leaf = snapshotLink( folder, name, Arn::LinkFlags(), syncMode, isNotify);
+        if (!leaf)  continue;
+
+        //// Own value of each twin is loaded, no crossing to the other twin
+        switch (type) {
+        case Arn::DataType::Int:
+            if (val.size() == 4)
+                leaf->setValue( int( qFromLittleEndian<qint32>( reinterpret_cast<const uchar*>( val.constData()))),
+                                0, true);
+            break;
+        case Arn::DataType::Real:
+            if (val.size() == 8) {
+                quint64  realBits = qFromLittleEndian<quint64>( reinterpret_cast<const uchar*>( val.constData()));
+                double  real;
+                memcpy( &real, &realBits, sizeof(real));
+                leaf->setValue( ARNREAL( real), 0, true);
+            }
+            break;
+        case Arn::DataType::String:
+            leaf->setValue( QString::fromUtf8( val.constData(), val.size()), 0, true);
+            break;
+        case Arn::DataType::ByteArray:
+            leaf->setValue( val, 0, true);
+            break;
+        case Arn::DataType::Variant:
+        {
+            QVariant  value;
+            QDataStream  stream( val);
+            stream >> value;
+            leaf->setValue( value, 0, true);
+            break;
+        }
+        default:;
+        }
+
+        if (modeBits & SNAPMODE_PIPE)
+            leaf->setPipeMode( true, false);
+        if (modeBits & SNAPMODE_SAVE)
+            leaf->setSaveMode( true);
+        if (modeBits & SNAPMODE_ATOMICOP)
+            leaf->setAtomicOpProvider( true);
+    }
+
+    bool  isOk = reader.isOk() && folderStack.isEmpty();
+    if (!isOk)
+        errorLog( QString(tr("Load snapshot corrupt file:")) + fileName, ArnError::CreateError);
+
+    topFolder->deref();  // Ok, as this is main thread
+    return isOk;
+}
+
+
+/// Get child for snapshot loading, a new link is created without the general checks in getRawLink()
+ArnLink*  ArnM::snapshotLink( ArnLink* parent, const QString& name, Arn::LinkFlags flags,
+                              Arn::ObjectSyncMode syncMode, bool isNotify)
+{
+    ArnLink*  child = parent->findLink( name);
+    if (child) {  // Existing link
+        if (child->isRetired() || (child->isFolder() != flags.is( flags.Folder))) {
+            errorLog( QString(tr("Load snapshot skip, Path:")) + child->linkPath(),
+                      ArnError::CreateError);
+            return arnNullptr;
+        }
+        child->addSyncMode( syncMode);
+        return child;
+    }
+
+    if ((name.isEmpty() && !flags.is( flags.Folder)) || name.endsWith("!!")) {
+        errorLog( QString(tr("Load snapshot invalid name, Path:")) + parent->linkPath(),
+                  ArnError::CreateError);
+        return arnNullptr;
+    }
+
+    ArnLink::treeLock()->lockForWrite();
+    child = new ArnLink( parent, name, flags);
+    ArnLink::treeLock()->unlock();
+    if (flags.is( flags.Folder))
+        ++_countFolder;
+    else
+        ++_countLeaf;
+
+    child->_hasBeenSetup = true;
+    child->addSyncMode( syncMode);
+    if (child->isProvider())  // Make sure a provider link has a twin, ie a value link
+        addTwinMain( child->linkPath(), child, syncMode, flags.f | flags.CreateAllowed);
+
+    if (isNotify) {
+        ArnEvLinkCreate  arnEvLinkCreate( child->linkPath(), child, true);
+        child->sendEventsDirRoot( &arnEvLinkCreate, parent);
+    }
+    return child;
+}
+
+
+bool  ArnM::isSubscribedToRoot( const ArnLink* link)
+{
+    for (; link; link = link->parent()) {
+        if (link->_subscribeTab && !link->_subscribeTab->isEmpty())  return true;
+    }
+    return false;
+}
+
+
 #ifndef DOXYGEN_SKIP
 // Must onlty be called fronm main thread (application)
 ArnLink*  ArnM::root()
@@ -607,6 +1027,9 @@ ArnLink*  ArnM::linkThread( const QString& path, Arn::LinkFlags flags, Arn::Obje
 {
     flags.set( flags.Threaded);
 
+    ArnLink*  foundLink = linkThreadFind( path, flags);
+    if (foundLink)  return foundLink;  // Existing link, no need for main-thread
+
     ArnThreadComCaller  threadCom;
 
     threadCom.p()->_retObj = arnNullptr;  // Just in case ...
@@ -626,10 +1049,53 @@ ArnLink*  ArnM::linkThread( const QString& path, Arn::LinkFlags flags, Arn::Obje
 }
 
 
+/// Threaded - must be threadsafe
+/// Only existing and fully setup threaded links are found, anything else is left for linkMain()
+ArnLink*  ArnM::linkThreadFind( const QString& path, Arn::LinkFlags flags)
+{
+    QString  pathNorm = Arn::fullPath( path);
+    if (pathNorm.endsWith("/")) {
+        flags.set( flags.Folder);
+        pathNorm.resize( pathNorm.size() - 1);  // Remove '/' at end  (Also root become "")
+    }
+    QStringList  pathlist = pathNorm.split("/");
+    int  pathListSize = pathlist.size();
+    if (pathListSize < 2)  return arnNullptr;  // Root is not handled
+
+    QReadLocker  treeLocker( ArnLink::treeLock());
+
+    ArnLink*  currentLink = root();
+    for (int i = 1; i < pathListSize; ++i) {
+        bool  isLast = (i == pathListSize - 1);
+        currentLink = currentLink->findLink( pathlist.at(i));
+        if (!currentLink)  return arnNullptr;
+        if (!currentLink->isThreaded())  return arnNullptr;  // Must be setup by main-thread
+        if (currentLink->isRetired())  return arnNullptr;
+        if (currentLink->isFolder() != (!isLast || flags.is( flags.Folder)))  return arnNullptr;
+    }
+    if (!currentLink->_hasBeenSetup)  return arnNullptr;
+    ArnLink*  twin = currentLink->twinLink();
+    if (currentLink->isProvider()  &&  !twin)  return arnNullptr;
+    if (twin  &&  !twin->isThreaded())  return arnNullptr;
+
+    //// Link can't be retired or deleted while tree is read locked
+    if (!currentLink->refIfInUse())  return arnNullptr;  // Unreferenced, main-thread takes it
+    if (Arn::debugThreading)  qDebug() << "link-thread: found path=" << path;
+    return currentLink;
+}
+
+
 ArnLink*  ArnM::linkMain( const QString& path, Arn::LinkFlags flags, Arn::ObjectSyncMode syncMode)
 {
     // qDebug() << "### link-main: path=" << path;
-    QString  pathNorm = Arn::fullPath( path);
+    QString  pathFull = Arn::fullPath( path);
+    ArnLink*  cachedLink = pathCacheFind( pathFull, flags);
+    if (cachedLink) {
+        cachedLink->ref();
+        return cachedLink;
+    }
+
+    QString  pathNorm = pathFull;
     if (pathNorm.endsWith("/")) {
         flags.set( flags.Folder);
         pathNorm.resize( pathNorm.size() - 1);  // Remove '/' at end  (Also root become "")
@@ -656,11 +1122,56 @@ ArnLink*  ArnM::linkMain( const QString& path, Arn::LinkFlags flags, Arn::Object
         }
     }
 
+    pathCacheAdd( pathFull, currentLink);
     currentLink->ref();
     return currentLink;
 }
 
 
+ArnLink*  ArnM::pathCacheFind( const QString& path, Arn::LinkFlags flags)
+{
+    ArnLink*  link = instance()._pathCache.value( path, arnNullptr);
+    if (!link)  return arnNullptr;
+
+    //// Anything needing the full walk (errors, threaded setup or twin creation) is not a hit
+    if (link->isRetired())  return arnNullptr;
+    if (flags.is( flags.Folder)  &&  !link->isFolder())  return arnNullptr;
+    if (flags.is( flags.Threaded)  &&  !link->isThreaded())  return arnNullptr;
+    if (link->isProvider()  &&  !link->_twin)  return arnNullptr;
+
+    return link;
+}
+
+
+void  ArnM::pathCacheAdd( const QString& path, ArnLink* link)
+{
+    if (!link  ||  link->_isPathCached  ||  !link->parent())  return;  // Root is not cached
+    if (path != link->linkPath())  return;  // Only cache normalized paths, needed for removal
+
+    QHash<QString,ArnLink*>&  pathCache = instance()._pathCache;
+    if (pathCache.size() >= PATHCACHE_MAX) {  // Evicted links must be cachable again
+        foreach (ArnLink* cachedLink, pathCache) {
+            cachedLink->_isPathCached = false;
+        }
+        pathCache.clear();
+    }
+    pathCache.insert( path, link);
+    link->_isPathCached = true;
+}
+
+
+void  ArnM::pathCacheRemove( ArnLink* link)
+{
+    if (!link  ||  !link->_isPathCached)  return;
+
+    link->_isPathCached = false;
+    QHash<QString,ArnLink*>&  pathCache = instance()._pathCache;
+    QHash<QString,ArnLink*>::iterator  it = pathCache.find( link->linkPath());
+    if ((it != pathCache.end())  &&  (it.value() == link))
+        pathCache.erase( it);
+}
+
+
 ArnLink*  ArnM::linkMain( const QString& path, ArnLink *parent, const QString& name, Arn::LinkFlags flags,
                           Arn::ObjectSyncMode syncMode)
 {
@@ -780,6 +1291,13 @@ ArnLink*  ArnM::getRawLink( ArnLink *parent, const QString& name, Arn::LinkFlags
 
     ArnLink *child = parent->findLink( name);
 
+    if (child  &&  child->_isReclaimQueued  &&  flags.is( flags.CreateAllowed)) {
+        // Retired link waiting for reclaim, it must be deleted now to be created again.
+        // Only its own tree and at most a batch, a big tree is left to deferred reclaim
+        reclaimRetiredMain( RECLAIM_BATCH, child);
+        child = parent->findLink( name);
+    }
+
     if (child == arnNullptr) {   // link not existing, create it ?
         if (!flags.is( flags.CreateAllowed)) {
             // Creating new items are not allowed
@@ -807,7 +1325,9 @@ ArnLink*  ArnM::getRawLink( ArnLink *parent, const QString& name, Arn::LinkFlags
             return arnNullptr;
         }
         // Create folders or items when needed
+        ArnLink::treeLock()->lockForWrite();
         child = new ArnLink( parent, name, flags);
+        ArnLink::treeLock()->unlock();
         if (flags.is( flags.Folder))
             ++_countFolder;
         else
@@ -889,21 +1409,63 @@ void  ArnM::destroyLink( const QString& path, bool isGlobal)
 }
 
 
+void  ArnM::dropValueCaches( const QString& path)
+{
+    if (isMainThread()) {
+        Arn::LinkFlags  flags;
+        ArnLink*  link = ArnM::link( path, flags.SilentError);
+        if (link) {
+            dropValueCachesMain( link);
+            link->deref();
+        }
+        return;
+    }
+
+    /// Threaded version of dropValueCaches
+    QMetaObject::invokeMethod( &instance(),
+                               "dropValueCaches",
+                               Qt::QueuedConnection,
+                               Q_ARG( QString, path));
+}
+
+
+/// This will be called recursively in main-thread
+void  ArnM::dropValueCachesMain( ArnLink* link)
+{
+    link->dropValueCache();  // Twins are also children of the same folder
+
+    const ArnLinkList&  children = link->children();
+    int  childNum = children.size();
+    for (int i = 0; i < childNum; ++i) {
+        dropValueCachesMain( children.at(i));
+    }
+}
+
+
 /// This will be called recursively in main-thread
 void  ArnM::destroyLinkMain( ArnLink* link, ArnLink* startLink, bool isGlobal)
 {
     if (!link)  return;
     if (link->isRetired())  return;  // This link is already retired
 
+    if ((link == startLink)  &&  link->isFolder()) {
+        destroyTreeMain( link, isGlobal);
+        return;
+    }
+
     /// Mark this link as retired
     ArnLink::RetireType  rt;
     rt = startLink->isFolder() ? rt.Tree
                                : isGlobal ? rt.LeafGlobal
                                           : rt.LeafLocal;
     ArnLink*  twin = link->twinLink();
+    ArnLink::treeLock()->lockForWrite();
     link->setRetired( rt);
     if (twin)
         twin->setRetired( rt);
+    ArnLink::treeLock()->unlock();
+    pathCacheRemove( link);
+    pathCacheRemove( twin);
     link->ref();  // At least one ref to protect this link
 
     /// Make all childs retired by recursion
@@ -924,16 +1486,125 @@ void  ArnM::destroyLinkMain( ArnLink* link, ArnLink* startLink, bool isGlobal)
 }
 
 
+/// Bulk retire of a folder tree
+/// Only links having subscribers are notified and deletion of the links is deferred
+void  ArnM::destroyTreeMain( ArnLink* startLink, bool isGlobal)
+{
+    ArnM&  arnM = instance();
+
+    //// Collect the tree, a folder is always before its children
+    QList<ArnLink*>  treeLinks;
+    treeLinks += startLink;
+    for (int i = 0; i < treeLinks.size(); ++i) {
+        foreach (ArnLink* child, treeLinks.at(i)->children()) {
+            if (!child->isRetired())
+                treeLinks += child;
+        }
+    }
+    int  linkNum = treeLinks.size();
+
+    ArnLink::treeLock()->lockForWrite();
+    for (int i = 0; i < linkNum; ++i) {
+        ArnLink*  link = treeLinks.at(i);
+        link->setRetired( ArnLink::RetireType::Tree);
+        link->_isReclaimQueued = true;  // Not deleted by zero-ref while notifying
+    }
+    ArnLink::treeLock()->unlock();
+
+    //// Children are notified before their folder
+    for (int i = linkNum - 1; i >= 0; --i) {
+        ArnLink*  link = treeLinks.at(i);
+        pathCacheRemove( link);
+
+        if (link == startLink) {
+            ArnEvRetired  arnEvRetiredBelow( startLink, true, isGlobal);
+            for (ArnLink* dirLink = startLink->parent(); dirLink; dirLink = dirLink->parent()) {
+                if (dirLink->hasSubscriber())
+                    dirLink->sendArnEvent( &arnEvRetiredBelow);
+            }
+        }
+        if (link->hasSubscriber()) {
+            ArnEvRetired  arnEvRetired( startLink, false, isGlobal);
+            link->sendArnEvent( &arnEvRetired);
+        }
+
+        if (link->isProvider()  &&  link->_twin)  continue;  // Reclaimed together with its twin
+        arnM._reclaimQueue += link;
+    }
+
+    if (!arnM._isReclaimPosted) {
+        arnM._isReclaimPosted = true;
+        QMetaObject::invokeMethod( &arnM, "reclaimRetired", Qt::QueuedConnection);
+    }
+}
+
+
+void  ArnM::reclaimRetired()
+{
+    _isReclaimPosted = false;
+    reclaimRetiredMain( RECLAIM_BATCH);
+
+    if (!_reclaimQueue.isEmpty()) {
+        _isReclaimPosted = true;
+        QMetaObject::invokeMethod( this, "reclaimRetired", Qt::QueuedConnection);
+    }
+}
+
+
+/// Links still referenced are left to zero-ref, which then also takes their parent folders
+/// If topLink is given, only links in its tree are reclaimed
+void  ArnM::reclaimRetiredMain( int maxNum, ArnLink* topLink)
+{
+    QList<ArnLink*>&  reclaimQueue = instance()._reclaimQueue;
+    if (reclaimQueue.isEmpty()  ||  (maxNum <= 0))  return;
+
+    ArnLink::treeLock()->lockForWrite();
+    QList<ArnLink*>  keptQueue;
+    int  num = 0;
+    int  i   = 0;
+    for (; (i < reclaimQueue.size())  &&  (num < maxNum); ++i) {
+        ArnLink*  link = reclaimQueue.at(i);
+        if (topLink) {
+            ArnLink*  dirLink = link;
+            while (dirLink  &&  (dirLink != topLink)) {
+                dirLink = dirLink->parent();
+            }
+            if (!dirLink) {  // Not in the tree
+                keptQueue += link;
+                continue;
+            }
+        }
+        ++num;
+        link->_isReclaimQueued = false;
+        if (link->_twin)
+            link->_twin->_isReclaimQueued = false;
+        if ((link->refCount() >= 0)  ||  !link->children().isEmpty())  continue;
+
+        if (Arn::debugLinkDestroy)  qDebug() << "Reclaim: delete link path=" << link->linkPath();
+        if (link->isFolder())
+            --_countFolder;
+        else {
+            --_countLeaf;
+            if (link->isBiDirMode())
+                --_countLeaf;
+        }
+        delete link;  // This will also delete an existing twin
+    }
+    reclaimQueue = keptQueue + reclaimQueue.mid(i);
+    ArnLink::treeLock()->unlock();
+}
+
+
 void  ArnM::doZeroRefLink( ArnLink* link)
 {
     if (!link)  return;
     link->decZeroRefs();
-    if (!link->isLastZeroRef())  return;  // Link reused & more zeroRefs will come
-
-    link->setRefCount( -1);  // Mark link as fully de-referenced
+    //// Mark link as fully de-referenced, unless link reused & more zeroRefs will come
+    if (!link->setFullyDerefIfLast())  return;
     // qDebug() << "ZeroRef: set fully deref path=" << link->linkPath();
 
     while (link->isRetired()  &&
+           !link->_isReclaimQueued  &&
            link->refCount() < 0  &&
            link->children().size() == 0) {
         ArnLink*  parent = link->parent();
@@ -946,7 +1617,11 @@ void  ArnM::doZeroRefLink( ArnLink* link)
             if (link->isBiDirMode())
                 --_countLeaf;
         }
+        pathCacheRemove( link);
+        pathCacheRemove( link->twinLink());
+        ArnLink::treeLock()->lockForWrite();
         delete link;  // This will also delete an existing twin
+        ArnLink::treeLock()->unlock();
 
         link = parent;
     }
@@ -1004,6 +1679,13 @@ void  ArnM::onTimerMetrics()
     _countFolderLink->setValue( _countFolder);
     _countLeafLink->setValue( _countLeaf);
     _countRefLink->setValue( _countRef);
+
+    //// Average bytes of value storage per leaf, excluding string and array payloads
+    int  countValueExt = ArnLink::valueExtCount();
+    _countValueExtLink->setValue( countValueExt);
+    qint64  valueBytes = qint64( _countLeaf) * ArnLink::valueSizeBase() +
+                         qint64( countValueExt) * ArnLink::valueSizeExt();
+    _valueSizeLink->setValue( _countLeaf > 0 ? int( valueBytes / _countLeaf) : 0);
 }
 
 
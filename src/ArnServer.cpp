@@ -36,21 +36,32 @@
 #include "ArnInc/ArnLib.hpp"
 #include "ArnSync.hpp"
 #include "ArnSyncLogin.hpp"
-#include "ArnItemNet.hpp"
+#include "ArnSyncShm.hpp"
 #include <QSslSocket>
+#include <QLocalServer>
+#include <QSocketNotifier>
 #include <QHostInfo>
 #include <QNetworkInterface>
 #include <QHostAddress>
 #include <QPair>
+#include <QTimer>
+#include <QMutexLocker>
 #include <QDebug>
+#ifdef Q_OS_UNIX
+# include <unistd.h>
+#endif
+
+#define IOTHREAD_STATPERIOD  2000  // ms
 
 using Arn::XStringMap;
 
 
-ArnServerSession::ArnServerSession( QSslSocket* socket, ArnServer* arnServer)
-    : QObject( arnServer)
+ArnServerSession::ArnServerSession( QSslSocket* socket, ArnServer* arnServer, QObject* parent)
+    : QObject( parent ? parent : arnServer)
 {
     QHostAddress  remoteAddr = socket->peerAddress();
+    if (remoteAddr.isNull())  // Local socket
+        remoteAddr = QHostAddress::LocalHost;
     // QHostAddress  localAddr  = socket->localAddress();
     // qDebug() << "ArnServerNetSync: remoteAddr=" << remoteAddr.toString()
     //          << " localAddr=" << localAddr.toString();
@@ -59,11 +70,16 @@ ArnServerSession::ArnServerSession( QSslSocket* socket, ArnServer* arnServer)
     _arnServer = arnServer;
     _socket->setParent( this);  // Session takes ownership of socket
     _arnNetSync = new ArnSync( _socket, false, this);
+    ArnSyncShm*  shm = _socket->findChild<ArnSyncShm*>();  // Attached by ArnLocalServer
+    if (shm)
+        _arnNetSync->setShm( shm);
     _arnNetSync->setSessionHandler( this);
     _arnNetSync->setArnLogin( _arnServer->arnLogin());
     _arnNetSync->setDemandLogin( _arnServer->isDemandLogin()
                               && _arnServer->isDemandLoginNet( remoteAddr));
     _arnNetSync->setEncryptPolicy( _arnServer->encryptPolicy());
+    if (thread() != _arnServer->thread())  // Session is in an I/O thread
+        _arnNetSync->setThreadedStat();
     // qDebug() << "ArnServerNetSync new session: remoteAddr=" << remoteAddr.toString()
     //          << "isDemandLoginNet=" << _arnServer->isDemandLoginNet( remoteAddr);
     _arnNetSync->start();
@@ -73,36 +89,41 @@ ArnServerSession::ArnServerSession( QSslSocket* socket, ArnServer* arnServer)
     }
     _arnNetSync->setWhoIAm( _arnServer->whoIAm());
 
-    _arnNetEar  = new ArnItemNetEar( this);
-    _arnNetEar->open("/");  // MW: Optimize to only mountPoint:s ?
-
     connect( _arnNetSync, SIGNAL(stateChanged(int)), this, SLOT(doSyncStateChanged(int)));
     connect( _arnNetSync, SIGNAL(destroyed(QObject*)), this, SLOT(shutdown()));
+    connect( _socket, SIGNAL(disconnected()), this, SLOT(retire()));  // After sync has handled it
     connect( _arnNetSync, SIGNAL(xcomDelete(QString)), this, SLOT(onCommandDelete(QString)));
     connect( _arnNetSync, SIGNAL(infoReceived(int)), this, SIGNAL(infoReceived(int)));
     connect( _arnNetSync, SIGNAL(loginCompleted()), this, SIGNAL(loginCompleted()));
     connect( _arnNetSync, SIGNAL(messageReceived(int,QByteArray)),
              this, SIGNAL(messageReceived(int,QByteArray)));
-    connect( _arnNetEar, SIGNAL(arnTreeDestroyed(QString,bool)),
-             this, SLOT(doDestroyArnTree(QString,bool)));
 }
 
 
 void  ArnServerSession::shutdown()
 {
-    _arnNetSync = arnNullptr;  // Mark retired
-    _arnNetEar->close();
-    deleteLater();
+    retire();
+    if (thread() != _arnServer->thread())  // Session is in an I/O thread
+        QMetaObject::invokeMethod( this, "deleteInServerThread", Qt::QueuedConnection);  // After sync is gone
+    else
+        deleteLater();
 }
 
 
-void  ArnServerSession::doDestroyArnTree( const QString& path, bool isGlobal)
+/// Users of the session are in the server thread, they get destroyed() without delay
+void  ArnServerSession::deleteInServerThread()
 {
-    Q_UNUSED(isGlobal)  // Destruction of tree on server will allways be global
+    setParent( arnNullptr);
+    moveToThread( _arnServer->thread());
+    deleteLater();
+}
 
-    if (!_arnNetSync)  return;  // Retired
 
-    _arnNetSync->sendDelete( path);
+/// The sync is about to be deleted, it is no longer used from any thread
+void  ArnServerSession::retire()
+{
+    QMutexLocker  locker( &_mutex);
+    _arnNetSync = arnNullptr;  // Mark retired
 }
 
 
@@ -136,6 +157,7 @@ QSslSocket*  ArnServerSession::socket()  const
 
 Arn::XStringMap  ArnServerSession::remoteWhoIAm()  const
 {
+    QMutexLocker  locker( &_mutex);
     if (!_arnNetSync)  return XStringMap();  // Retired
 
     return XStringMap( _arnNetSync->remoteWhoIAm());
@@ -144,6 +166,7 @@ Arn::XStringMap  ArnServerSession::remoteWhoIAm()  const
 
 QString  ArnServerSession::loginUserName()  const
 {
+    QMutexLocker  locker( &_mutex);
     if (!_arnNetSync)  return QString();  // Retired
 
     return _arnNetSync->loginUserName();
@@ -152,6 +175,7 @@ QString  ArnServerSession::loginUserName()  const
 
 Arn::Allow  ArnServerSession::getAllow()  const
 {
+    QMutexLocker  locker( &_mutex);
     if (!_arnNetSync)  return Arn::Allow();  // Retired
 
     return _arnNetSync->getAllow();
@@ -159,6 +183,17 @@ Arn::Allow  ArnServerSession::getAllow()  const
 
 
 void  ArnServerSession::sendMessage( int type, const QByteArray& data)
+{
+    if (QThread::currentThread() != thread()) {  // Session is in an I/O thread
+        QMetaObject::invokeMethod( this, "doSendMessage", Qt::QueuedConnection,
+                                   Q_ARG( int, type), Q_ARG( QByteArray, data));
+        return;
+    }
+    doSendMessage( type, data);
+}
+
+
+void  ArnServerSession::doSendMessage( int type, const QByteArray& data)
 {
     if (!_arnNetSync)  return;  // Retired
 
@@ -168,6 +203,7 @@ void  ArnServerSession::sendMessage( int type, const QByteArray& data)
 
 bool  ArnServerSession::getTraffic( quint64& in, quint64& out)  const
 {
+    QMutexLocker  locker( &_mutex);
     if (!_arnNetSync)  return false;  // Retired
 
     _arnNetSync->getTraffic( in, out);
@@ -175,12 +211,174 @@ bool  ArnServerSession::getTraffic( quint64& in, quint64& out)  const
 }
 
 
+bool  ArnServerSession::getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const
+{
+    QMutexLocker  locker( &_mutex);
+    if (!_arnNetSync)  return false;  // Retired
+
+    _arnNetSync->getTraffic( in, out, inRaw, outRaw);
+    return true;
+}
+
+
+bool  ArnServerSession::getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const
+{
+    QMutexLocker  locker( &_mutex);
+    if (!_arnNetSync)  return false;  // Retired
+
+    _arnNetSync->getWriteBatchStat( writes, records, maxRecords);
+    return true;
+}
+
+
+bool  ArnServerSession::getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const
+{
+    QMutexLocker  locker( &_mutex);
+    if (!_arnNetSync)  return false;  // Retired
+
+    _arnNetSync->getQueueDelayStat( isPrio, count, totalUsec, maxUsec);
+    return true;
+}
+
+
+Arn::XStringMap  ArnServerSession::commandStat()  const
+{
+    QMutexLocker  locker( &_mutex);
+    if (!_arnNetSync)  return Arn::XStringMap();  // Retired
+
+    return _arnNetSync->commandStat();
+}
+
+
+
+ArnServerIoThread::ArnServerIoThread( ArnServer* arnServer, int index)
+{
+    _arnServer   = arnServer;
+    _statTimer   = arnNullptr;
+    _lastTraffic = 0;
+    _statPath    = Arn::pathServer + "IoThread/" + QString::number( index) + "/";
+    _thread.setObjectName("ArnServerIo" + QString::number( index));
+
+    moveToThread( &_thread);
+    connect( &_thread, SIGNAL(started()), this, SLOT(onStarted()));
+    connect( &_thread, SIGNAL(finished()), this, SLOT(onFinished()));
+}
+
+
+ArnServerIoThread::~ArnServerIoThread()
+{
+    stop();
+}
+
+
+void  ArnServerIoThread::start()
+{
+    _thread.start();
+}
+
+
+void  ArnServerIoThread::stop()
+{
+    if (!_thread.isRunning())  return;
+
+    _thread.quit();
+    _thread.wait();
+}
+
+
+int  ArnServerIoThread::sessionCount()  const
+{
+    return _sessionCount.loadAcquire();
+}
+
+
+/// Called from the server thread, the session is made in the I/O thread
+void  ArnServerIoThread::addConnection( qint64 socketDescriptor, ArnSyncShm* shm)
+{
+    _sessionCount.ref();
+    if (shm)
+        shm->moveToThread( &_thread);
+    QMetaObject::invokeMethod( this, "doAddConnection", Qt::QueuedConnection,
+                               Q_ARG( qint64, socketDescriptor), Q_ARG( QObject*, shm));
+}
+
+
+void  ArnServerIoThread::onStarted()
+{
+    _statTimer = new QTimer( this);
+    connect( _statTimer, SIGNAL(timeout()), this, SLOT(doStat()));
+    _statTimer->start( IOTHREAD_STATPERIOD);
+    _statClock.start();
+}
+
+
+/// Remaining sessions are handed to the server thread, as when they end by themselves
+void  ArnServerIoThread::onFinished()
+{
+    foreach (ArnServerSession* session, findChildren<ArnServerSession*>()) {
+        QMetaObject::invokeMethod( session, "deleteInServerThread", Qt::DirectConnection);
+    }
+    delete _statTimer;
+    _statTimer = arnNullptr;
+}
+
+
+void  ArnServerIoThread::doAddConnection( qint64 socketDescriptor, QObject* shmObj)
+{
+    QSslSocket*  socket = new QSslSocket;
+    if (!socket->setSocketDescriptor( ARNSOCKD( socketDescriptor))) {
+        delete socket;
+        delete shmObj;
+        _sessionCount.deref();
+        return;
+    }
+    if (shmObj)
+        shmObj->setParent( socket);  // Taken by the session
+
+    ArnServerSession*  session = new ArnServerSession( socket, _arnServer, this);
+    connect( session, SIGNAL(destroyed()), this, SLOT(onSessionEnd()));
+    QMetaObject::invokeMethod( _arnServer, "onIoSession", Qt::QueuedConnection,
+                               Q_ARG( QObject*, session));
+}
+
+
+void  ArnServerIoThread::onSessionEnd()
+{
+    _sessionCount.deref();
+}
+
+
+/// Load of this thread: sessions, traffic rate and event loop lag
+void  ArnServerIoThread::doStat()
+{
+    qint64  elapsed = _statClock.restart();
+    if (elapsed <= 0)  return;
+
+    quint64  traffic = 0;
+    foreach (ArnServerSession* session, findChildren<ArnServerSession*>()) {
+        quint64  in  = 0;
+        quint64  out = 0;
+        session->getTraffic( in, out);
+        traffic += in + out;
+    }
+    quint64  trafficDiff = traffic >= _lastTraffic ? traffic - _lastTraffic : traffic;  // Ended sessions gone
+    _lastTraffic = traffic;
+
+    ArnM::setValue( _statPath + "Sessions/value", sessionCount());
+    ArnM::setValue( _statPath + "Traffic/value", int( trafficDiff * 1000 / quint64( elapsed)));  // bytes/s
+    ArnM::setValue( _statPath + "Lag/value", int( qMax( elapsed - IOTHREAD_STATPERIOD, qint64(0))));  // ms
+}
+
+
 
 ArnServerPrivate::ArnServerPrivate( ArnServer::Type serverType)
 {
     _tcpServerActive = false;
+    _ioThreadNum     = 0;
     _isDemandLogin   = false;
     _sslServer       = new ArnSslServer;
+    _localServer     = new ArnLocalServer;
+    _shmServer       = new ArnLocalServer( true);
     _arnLogin        = new ArnSyncLogin;
     _newSession      = arnNullptr;
     _serverType      = serverType;
@@ -192,6 +390,9 @@ ArnServerPrivate::ArnServerPrivate( ArnServer::Type serverType)
 ArnServerPrivate::~ArnServerPrivate()
 {
     delete _sslServer;
+    delete _localServer;
+    delete _shmServer;
+    qDeleteAll( _ioThreads);  // Stops the threads
     delete _arnLogin;
 }
 
@@ -206,8 +407,31 @@ ArnSslServer::~ArnSslServer()
 }
 
 
+void  ArnSslServer::setIoThreads( const QList<ArnServerIoThread*>& ioThreads)
+{
+    _ioThreads = ioThreads;
+}
+
+
+/// Session goes to the I/O thread with least sessions
+static ArnServerIoThread*  leastLoadedIoThread( const QList<ArnServerIoThread*>& ioThreads)
+{
+    ArnServerIoThread*  ioThread = ioThreads.at(0);
+    foreach (ArnServerIoThread* ioThreadT, ioThreads) {
+        if (ioThreadT->sessionCount() < ioThread->sessionCount())
+            ioThread = ioThreadT;
+    }
+    return ioThread;
+}
+
+
 void  ArnSslServer::incomingConnection( ARNSOCKD socketDescriptor)
 {
+    if (!_ioThreads.isEmpty()) {
+        leastLoadedIoThread( _ioThreads)->addConnection( qint64( socketDescriptor));
+        return;
+    }
+
     QSslSocket*  socket = new QSslSocket;
     if (socket->setSocketDescriptor( socketDescriptor)) {
         addPendingConnection( socket);
@@ -234,6 +458,88 @@ QSslSocket*  ArnSslServer::nextPendingSslConnection()
 }
 
 
+ArnLocalServer::ArnLocalServer( bool isShm)
+{
+    _isShm = isShm;
+}
+
+
+ArnLocalServer::~ArnLocalServer()
+{
+    qDeleteAll( _pendingSockets);
+}
+
+
+void  ArnLocalServer::setIoThreads( const QList<ArnServerIoThread*>& ioThreads)
+{
+    _ioThreads = ioThreads;
+}
+
+
+/// The Unix domain socket is used by QSslSocket, i.e. same handling as a tcp session
+void  ArnLocalServer::incomingConnection( quintptr socketDescriptor)
+{
+    if (_isShm) {  // Session is added when the client has passed the shared memory
+        QSocketNotifier*  notifier = new QSocketNotifier( int( socketDescriptor), QSocketNotifier::Read, this);
+        connect( notifier, SIGNAL(activated(int)), this, SLOT(doShmSetup()));
+        return;
+    }
+
+    addConnection( socketDescriptor, arnNullptr);
+}
+
+
+void  ArnLocalServer::doShmSetup()
+{
+    QSocketNotifier*  notifier = qobject_cast<QSocketNotifier*>( sender());
+    if (!notifier)  return;
+
+    int  fd = int( notifier->socket());
+    notifier->setEnabled( false);
+    notifier->deleteLater();
+
+    ArnSyncShm*  shm = ArnSyncShm::receiveSetup( fd);
+    if (!shm) {
+        ArnM::errorLog( QString(tr("Arn Server Shm setup failed, server=")) + serverName(),
+                        ArnError::ConnectionError);
+#ifdef Q_OS_UNIX
+        ::close( fd);
+#endif
+        return;
+    }
+
+    addConnection( quintptr( fd), shm);
+}
+
+
+void  ArnLocalServer::addConnection( quintptr socketDescriptor, ArnSyncShm* shm)
+{
+    if (!_ioThreads.isEmpty()) {
+        leastLoadedIoThread( _ioThreads)->addConnection( qint64( socketDescriptor), shm);
+        return;
+    }
+
+    QSslSocket*  socket = new QSslSocket;
+    if (socket->setSocketDescriptor( ARNSOCKD( socketDescriptor))) {
+        if (shm)
+            shm->setParent( socket);  // Taken by the session
+        _pendingSockets.enqueue( socket);
+        emit newConnection();  // Done by the QLocalServer implementation that is overridden
+    }
+    else {
+        delete socket;
+        delete shm;
+    }
+}
+
+
+QSslSocket*  ArnLocalServer::nextPendingSslConnection()
+{
+    if (_pendingSockets.isEmpty())  return arnNullptr;
+
+    return _pendingSockets.dequeue();
+}
+
 
 ArnServer::ArnServer( Type serverType, QObject *parent)
     : QObject( parent)
@@ -271,6 +577,8 @@ void  ArnServer::start( int port, QHostAddress listenAddr)
         }
     }
 
+    startIoThreads();
+
     if (d->_sslServer->listen( listenAddr, port)) {
         d->_tcpServerActive = true;
 
@@ -283,6 +591,78 @@ void  ArnServer::start( int port, QHostAddress listenAddr)
 }
 
 
+bool  ArnServer::startLocal( const QString& serverName)
+{
+    Q_D(ArnServer);
+
+#ifdef Q_OS_UNIX
+    startIoThreads();
+
+    QLocalServer::removeServer( serverName);  // Stale socket file from an ended server
+    if (d->_localServer->listen( serverName)) {
+        connect( d->_localServer, SIGNAL(newConnection()), this, SLOT(localConnection()));
+        return true;
+    }
+
+    ArnM::errorLog( QString(tr("Failed start Arn Server Local: ")) + serverName +
+                    " " + d->_localServer->errorString(), ArnError::ConnectionError);
+#else
+    ArnM::errorLog( QString(tr("Arn Server Local not supported on this platform: ")) + serverName,
+                    ArnError::ConnectionError);
+#endif
+    return false;
+}
+
+
+QString  ArnServer::localServerName()  const
+{
+    Q_D(const ArnServer);
+
+    return d->_localServer->serverName();
+}
+
+
+bool  ArnServer::startShm( const QString& serverName)
+{
+    Q_D(ArnServer);
+
+    if (!ArnSyncShm::isSupported()) {
+        ArnM::errorLog( QString(tr("Arn Server Shm not supported on this platform: ")) + serverName,
+                        ArnError::ConnectionError);
+        return false;
+    }
+
+    startIoThreads();
+
+    QLocalServer::removeServer( serverName);  // Stale socket file from an ended server
+    if (d->_shmServer->listen( serverName)) {
+        connect( d->_shmServer, SIGNAL(newConnection()), this, SLOT(localConnection()));
+        return true;
+    }
+
+    ArnM::errorLog( QString(tr("Failed start Arn Server Shm: ")) + serverName +
+                    " " + d->_shmServer->errorString(), ArnError::ConnectionError);
+    return false;
+}
+
+
+void  ArnServer::startIoThreads()
+{
+    Q_D(ArnServer);
+
+    if ((d->_ioThreadNum <= 0) || !d->_ioThreads.isEmpty())  return;  // No threads or started
+
+    for (int i = 0; i < d->_ioThreadNum; ++i) {
+        ArnServerIoThread*  ioThread = new ArnServerIoThread( this, i);
+        ioThread->start();
+        d->_ioThreads += ioThread;
+    }
+    d->_sslServer->setIoThreads( d->_ioThreads);
+    d->_localServer->setIoThreads( d->_ioThreads);
+    d->_shmServer->setIoThreads( d->_ioThreads);
+}
+
+
 int  ArnServer::port()
 {
     Q_D(ArnServer);
@@ -465,6 +845,35 @@ void  ArnServer::setWhoIAm( const Arn::XStringMap& whoIAmXsm)
 }
 
 
+void  ArnServer::setIoThreadNum( int threadNum)
+{
+    Q_D(ArnServer);
+
+    d->_ioThreadNum = qMax( threadNum, 0);
+}
+
+
+int  ArnServer::ioThreadNum()  const
+{
+    Q_D(const ArnServer);
+
+    return d->_ioThreadNum;
+}
+
+
+/// Session made in an I/O thread is announced in the server thread as usual
+void  ArnServer::onIoSession( QObject* sessionObj)
+{
+    Q_D(ArnServer);
+
+    d->_newSession = qobject_cast<ArnServerSession*>( sessionObj);
+    if (!d->_newSession)  return;
+
+    emit newSession();
+    d->_newSession = arnNullptr;
+}
+
+
 void  ArnServer::tcpConnection()
 {
     Q_D(ArnServer);
@@ -487,3 +896,22 @@ void  ArnServer::tcpConnection()
         break;
     }
 }
+
+
+void  ArnServer::localConnection()
+{
+    Q_D(ArnServer);
+
+    ArnLocalServer*  localServer = qobject_cast<ArnLocalServer*>( sender());
+    if (!localServer)  return;
+
+    while (QSslSocket*  socket = localServer->nextPendingSslConnection()) {
+        switch (d->_serverType) {
+        case Type::NetSync:
+            d->_newSession = new ArnServerSession( socket, this);
+            emit newSession();
+            d->_newSession = arnNullptr;
+            break;
+        }
+    }
+}
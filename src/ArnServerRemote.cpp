@@ -80,6 +80,8 @@ ArnServerRemoteSession::ArnServerRemoteSession( ArnServerSession* arnServerSessi
     _arnTraffic.open( _sessionPath + "Traffic/value");
     _arnTrafficIn.open( _sessionPath + "Traffic/In/value");
     _arnTrafficOut.open( _sessionPath + "Traffic/Out/value");
+    _arnWriteBatch.open( _sessionPath + "Traffic/Batch/value");
+    _arnWriteBatchMax.open( _sessionPath + "Traffic/Batch/Max/value");
 
     _arnKill.open( _sessionPath + "Kill/value");
     _arnKill = KillMode::Off;
@@ -230,6 +232,16 @@ void  ArnServerRemoteSession::doPoll()
             _arnTrafficIn.setValue( trafficIn);
             _arnTrafficOut.setValue( trafficOut);
         }
+
+        //// Write batching, average and max records per socket write
+        quint64  batchWrites;
+        quint64  batchRecords;
+        int      batchMaxRec;
+        isOk = _arnServerSession->getWriteBatchStat( batchWrites, batchRecords, batchMaxRec);
+        if (isOk && (batchWrites > 0)) {
+            _arnWriteBatch.setValue( ARNREAL( batchRecords) / ARNREAL( batchWrites));
+            _arnWriteBatchMax.setValue( batchMaxRec);
+        }
     }
 
     ++_pollCount;
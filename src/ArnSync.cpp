@@ -31,6 +31,7 @@
 
 #include "ArnSync.hpp"
 #include "ArnSyncLogin.hpp"
+#include "ArnSyncShm.hpp"
 #include "ArnItemNet.hpp"
 #include "ArnLink.hpp"
 #include "ArnInc/ArnClient.hpp"
@@ -44,17 +45,227 @@
 #include <QSslConfiguration>
 #include <QSslKey>
 #include <QFile>
+#include <QtEndian>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QHash>
 
 #include <QString>
 #include <QStringList>
 #include <QDebug>
+#include <algorithm>
 #include <limits.h>
+#include <string.h>
+#ifdef ARN_ZLIB
+# include <zlib.h>
+#endif
+
+#define ARNSYNCVER  "6.4"
+
+#define BINFRAME_HEADSIZE  4
+#define BINFRAME_MAXSIZE   0x10000000  // 256 MB
+
+#define COMPRESS_LEVEL     6
 
-#define ARNSYNCVER  "5.0"
+#define SYNCBATCH_MAXNUM   256  // Max items in one bulk sync record
+
+#define FLUXDATA_CACHEMAX  8192  // Max links with a shared coded flux value
+
+#define ITEMNETTAB_MINBITS  6  // 64 slots
 
 using Arn::XStringMap;
 
 
+//// Identifies this server instance, remote versions of values are only valid in the same instance
+static quint32  serverEpoch()
+{
+    static QAtomicInt  epoch(0);  // Sessions can be in several threads
+    if (!epoch.loadAcquire()) {
+        int  newEpoch;
+        do {
+            newEpoch = int( Arn::rand());
+        } while (!newEpoch);
+        epoch.testAndSetOrdered( 0, newEpoch);
+    }
+    return quint32( epoch.loadAcquire());
+}
+
+
+//// Coded value field of a link update, shared by all sessions sending it in the same format
+struct ArnSyncFluxData
+{
+    quint32  valueVersion;
+    QByteArray  field;
+};
+
+
+static QByteArray  sharedFluxDataField( const ArnItemNet* itemNet, quint32 valueVersion,
+                                        const XStringMap::Options& xop, bool isBinFrame)
+{
+    static QMutex  mutex;
+    static QHash<quint64,ArnSyncFluxData>  cache;
+
+    quint64  key = (quint64( itemNet->linkId()) << 32) | quint64( xop.toInt() << 1) | quint64( isBinFrame);
+    {
+        QMutexLocker  locker( &mutex);
+        QHash<quint64,ArnSyncFluxData>::const_iterator  i = cache.constFind( key);
+        if ((i != cache.constEnd()) && (i.value().valueVersion == valueVersion))
+            return i.value().field;  // Shared by reference
+    }
+
+    XStringMap  dataMap;
+    dataMap.setOptions( xop);
+    dataMap.add("data", itemNet->arnExport());
+    ArnSyncFluxData  fluxData;
+    fluxData.valueVersion = valueVersion;
+    fluxData.field        = isBinFrame ? dataMap.toBinary() : dataMap.toXString();
+
+    if (itemNet->valueVersion() != valueVersion)
+        return fluxData.field;  // Value updated during export, not shared
+
+    QMutexLocker  locker( &mutex);
+    if (cache.size() >= FLUXDATA_CACHEMAX)
+        cache.clear();  // Hot links are soon back
+    cache.insert( key, fluxData);
+    return fluxData.field;
+}
+
+
+//// Streaming compression of a connection, history is kept between socket writes
+struct ArnSyncCompress
+{
+#ifdef ARN_ZLIB
+    z_stream  deflateStream;
+    z_stream  inflateStream;
+#endif
+    bool  isDeflate;
+    bool  isInflate;
+    QByteArray  buf;
+
+    ArnSyncCompress()
+    {
+        isDeflate = false;
+        isInflate = false;
+    }
+};
+
+
+
+ArnItemNetTab::ArnItemNetTab()
+{
+    _size = 0;
+    rehash( ITEMNETTAB_MINBITS);
+}
+
+
+/// Index of the slot having netId or of the free slot where it ends the probe
+int  ArnItemNetTab::slotIndex( uint netId)  const
+{
+    uint  i = (netId * 0x9E3779B9u) >> (32 - _bits);  // Fibonacci hashing spreads near ids
+    const Slot*  slots = _slots.constData();
+    while (slots[i].itemNet && (slots[i].netId != netId)) {
+        i = (i + 1) & _mask;
+    }
+    return int(i);
+}
+
+
+void  ArnItemNetTab::rehash( int bits)
+{
+    QVector<Slot>  oldSlots = _slots;
+    Slot  freeSlot;
+    freeSlot.netId   = 0;
+    freeSlot.itemNet = arnNullptr;
+    _bits  = bits;
+    _mask  = (1u << bits) - 1;
+    _slots = QVector<Slot>( 1 << bits, freeSlot);
+    foreach (const Slot& slot, oldSlots) {
+        if (slot.itemNet)
+            _slots[ slotIndex( slot.netId)] = slot;
+    }
+}
+
+
+ArnItemNet*  ArnItemNetTab::value( uint netId)  const
+{
+    return _slots.at( slotIndex( netId)).itemNet;
+}
+
+
+bool  ArnItemNetTab::contains( uint netId)  const
+{
+    return value( netId) != arnNullptr;
+}
+
+
+void  ArnItemNetTab::insert( uint netId, ArnItemNet* itemNet)
+{
+    if (!itemNet)  return;
+
+    if ((_size + 1) * 2 > _slots.size())  // Max half full, keeps the probes short
+        rehash( _bits + 1);
+    Slot&  slot = _slots[ slotIndex( netId)];
+    if (!slot.itemNet)
+        ++_size;
+    slot.netId   = netId;
+    slot.itemNet = itemNet;
+}
+
+
+/// Following slots of the probe are moved back, no tombstones are needed
+int  ArnItemNetTab::remove( uint netId)
+{
+    uint  i = uint( slotIndex( netId));
+    if (!_slots.at(i).itemNet)  return 0;
+
+    Slot*  slots = _slots.data();
+    uint  j = i;
+    forever {
+        slots[i].itemNet = arnNullptr;
+        forever {
+            j = (j + 1) & _mask;
+            if (!slots[j].itemNet) {
+                --_size;
+                return 1;
+            }
+            uint  home = (slots[j].netId * 0x9E3779B9u) >> (32 - _bits);
+            if (((j - home) & _mask) >= ((j - i) & _mask))  break;  // Home is not between i and j
+        }
+        slots[i] = slots[j];
+        i = j;
+    }
+}
+
+
+int  ArnItemNetTab::size()  const
+{
+    return _size;
+}
+
+
+QList<uint>  ArnItemNetTab::keys()  const
+{
+    QList<uint>  list;
+    foreach (const Slot& slot, _slots) {
+        if (slot.itemNet)
+            list += slot.netId;
+    }
+    return list;
+}
+
+
+QList<ArnItemNet*>  ArnItemNetTab::values()  const
+{
+    QList<ArnItemNet*>  list;
+    foreach (const Slot& slot, _slots) {
+        if (slot.itemNet)
+            list += slot.itemNet;
+    }
+    return list;
+}
+
+
+
 ArnSync::ArnSync( QSslSocket *socket, bool isClientSide, QObject *parent)
     : QObject( parent)
 {
@@ -65,6 +276,7 @@ ArnSync::ArnSync( QSslSocket *socket, bool isClientSide, QObject *parent)
     _isClientSide     = isClientSide;
     _state            = State::Init;
     _isSending        = false;
+    _isBatchPosted    = false;
     _isClosed         = isClientSide;  // Server start as not closed
     _queueNumCount    = 0;
     _queueNumDone     = 0;
@@ -74,12 +286,38 @@ ArnSync::ArnSync( QSslSocket *socket, bool isClientSide, QObject *parent)
     _needEncrypted    = false;
     _remoteVer[0]     = 0;  // Mark not set
     _remoteVer[1]     = 0;
+    _remoteEpoch      = 0;
+    _resumeEpoch      = 0;
+    _syncBatchId      = 0;
     _loginReqCode     = 0;
     _loginNextSeq     = 0;
     _loginSalt1       = 0;
     _loginSalt2       = 0;
     _trafficIn        = 0;
     _trafficOut       = 0;
+    _trafficInRaw     = 0;
+    _trafficOutRaw    = 0;
+    _compress         = arnNullptr;
+    _shm              = arnNullptr;
+    _statMutex        = arnNullptr;
+    _isCompressWanted = false;
+    _isDeflatePending = false;
+    _isInflatePending = false;
+    _isWriteBatch     = false;
+    _isBinFrame       = false;
+    _isBinFramePending = false;
+    _writeBatchCount   = 0;
+    _writeBatchRecords = 0;
+    _writeBatchMaxRec  = 0;
+    for (int i = 0; i < Command::N; ++i) {
+        _commandCount[i] = 0;
+    }
+    for (int i = 0; i < 2; ++i) {
+        _queueDelayCount[i] = 0;
+        _queueDelaySum[i]   = 0;
+        _queueDelayMax[i]   = 0;
+    }
+    _queueClock.start();
     _clientSyncMode   = Arn::ClientSyncMode::Invalid;
     _encryptPol       = Arn::EncryptPolicy::PreferNo;
     _remoteEncryptPol = Arn::EncryptPolicy::Refuse;  // Default legacy, encryption not available remote
@@ -92,9 +330,11 @@ ArnSync::ArnSync( QSslSocket *socket, bool isClientSide, QObject *parent)
 
 ArnSync::~ArnSync()
 {
-    qDeleteAll( _itemNetMap);
+    qDeleteAll( _itemNetMap.values());
     qDeleteAll( _fluxRecPool);
     qDeleteAll( _fluxPipeQueue);
+    stopCompress();
+    delete _statMutex;
 }
 
 
@@ -156,11 +396,11 @@ void  ArnSync::start()
     else {
         _isConnected = true;
         if (_isDemandLogin) {
-            _allow       = Arn::Allow::None;
+            setAllow( Arn::Allow::None);
             _remoteAllow = Arn::Allow::None;
         }
         else {
-            _allow       = Arn::Allow::All;
+            setAllow( Arn::Allow::All);
             _remoteAllow = Arn::Allow::All;
             setState( State::Normal);
         }
@@ -175,16 +415,22 @@ void  ArnSync::startNormalSync()
     // qDebug() << "StartNormalSync:";
     clearNonPipeQueues();
 
-    /// All the existing netItems must be synced
+    /// Remote versions of values are only usable when reconnected to the same server instance
+    bool  isResume = _remoteEpoch && (_remoteEpoch == _resumeEpoch);
+    _resumeEpoch   = _remoteEpoch;
+
+    /// All the existing netItems must be synced, in netId order i.e. link creation order
+    QList<uint>  netIdList = _itemNetMap.keys();
+    std::sort( netIdList.begin(), netIdList.end());
     ArnItemNet*  itemNet;
     QByteArray  mode;
-    QMapIterator<uint,ArnItemNet*>  i( _itemNetMap);
-    while (i.hasNext()) {
-        i.next();
-        itemNet = i.value();
+    foreach (uint netId, netIdList) {
+        itemNet = _itemNetMap.value( netId);
 
         itemNet->resetDirtyValue();
         itemNet->resetDirtyMode();
+        if (!isResume)
+            itemNet->setRemoteVersion( 0, 0);
 
         _syncQueue.enqueue( itemNet);
         mode = itemNet->getModeString();
@@ -245,22 +491,231 @@ void  ArnSync::startNormalSync()
 
 void  ArnSync::sendXSMap( const XStringMap& xsMap)
 {
-    send( xsMap.toXString());
+    send( makeRecord( xsMap));
 }
 
 
+/// Record is in the current format, i.e. from makeRecord()
 void  ArnSync::send( const QByteArray& xString)
 {
     if (!_isConnected) {
         return;
     }
 
+    if (Arn::debugRecInOut)  qDebug() << "Rec-Out: " << xString;
     QByteArray  sendString;
-    sendString += xString;
-    if (Arn::debugRecInOut)  qDebug() << "Rec-Out: " << sendString;
-    sendString += "\r\n";
-    _socket->write( sendString);
-    _trafficOut += quint32( sendString.size());
+    // Write batch is written later together with other records
+    QByteArray&  dst = _isWriteBatch ? _writeBuf : sendString;
+    if (_isBinFrame) {  // Length prefixed binary frame
+        uchar  frameHead[ BINFRAME_HEADSIZE];
+        qToLittleEndian<quint32>( quint32( xString.size()), frameHead);
+        dst.append( reinterpret_cast<const char*>( frameHead), BINFRAME_HEADSIZE);
+        dst += xString;
+    }
+    else {
+        dst += xString;
+        dst += "\r\n";
+    }
+
+    if (!_isWriteBatch)
+        socketWrite( sendString);
+}
+
+
+/// All records are written here, compressed when negotiated
+void  ArnSync::socketWrite( const QByteArray& data)
+{
+#ifdef ARN_ZLIB
+    if (_compress && _compress->isDeflate) {
+        z_stream&  zs = _compress->deflateStream;
+        QByteArray&  out = _compress->buf;
+        zs.next_in  = reinterpret_cast<Bytef*>( const_cast<char*>( data.constData()));
+        zs.avail_in = uInt( data.size());
+        int  outSize = 0;
+        do {  // Sync flush, all data is sent now without adding latency
+            out.resize( outSize + data.size() / 2 + 64);
+            zs.next_out  = reinterpret_cast<Bytef*>( out.data() + outSize);
+            zs.avail_out = uInt( out.size() - outSize);
+            deflate( &zs, Z_SYNC_FLUSH);
+            outSize = out.size() - int( zs.avail_out);
+        } while (zs.avail_out == 0);
+        out.resize( outSize);
+
+        transportWrite( out);
+        addTrafficOut( data.size(), outSize);
+        return;
+    }
+#endif
+    transportWrite( data);
+    addTrafficOut( data.size(), data.size());
+}
+
+
+void  ArnSync::transportWrite( const QByteArray& data)
+{
+    if (_shm)
+        _shm->write( data);
+    else
+        _socket->write( data);
+}
+
+
+int  ArnSync::transportRead( char* data, int maxSize)
+{
+    if (_shm)
+        return _shm->read( data, maxSize);
+    return int(_socket->read( data, qint64( maxSize)));
+}
+
+
+void  ArnSync::addTrafficOut( int rawSize, int size)
+{
+    QMutexLocker  locker( _statMutex);
+    _trafficOutRaw += quint64( rawSize);
+    _trafficOut    += quint64( size);
+}
+
+
+void  ArnSync::addTrafficIn( int size)
+{
+    QMutexLocker  locker( _statMutex);
+    _trafficIn += quint64( size);
+}
+
+
+/// Received compressed data is inflated to the tail of _dataRemain
+bool  ArnSync::inflateAppend( const char* data, int size)
+{
+#ifdef ARN_ZLIB
+    if (!_compress || !_compress->isInflate)  return false;
+
+    z_stream&  zs = _compress->inflateStream;
+    zs.next_in  = reinterpret_cast<Bytef*>( const_cast<char*>( data));
+    zs.avail_in = uInt( size);
+    int  outSize = _dataRemain.size();
+    do {
+        _dataRemain.resize( outSize + qMax( size * 4, 4096));
+        zs.next_out  = reinterpret_cast<Bytef*>( _dataRemain.data() + outSize);
+        zs.avail_out = uInt( _dataRemain.size() - outSize);
+        int  ret = inflate( &zs, Z_SYNC_FLUSH);
+        if ((ret != Z_OK) && (ret != Z_BUF_ERROR)) {  // Z_BUF_ERROR is only no progress
+            _dataRemain.resize( outSize);
+            return false;
+        }
+        outSize = _dataRemain.size() - int( zs.avail_out);
+    } while (zs.avail_out == 0);
+    _dataRemain.resize( outSize);
+    return true;
+#else
+    Q_UNUSED( data)
+    Q_UNUSED( size)
+    return false;
+#endif
+}
+
+
+bool  ArnSync::isCompressSupported()
+{
+#ifdef ARN_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void  ArnSync::setCompress( bool isCompress)
+{
+    _isCompressWanted = isCompress;
+}
+
+
+bool  ArnSync::isCompress()  const
+{
+    return _compress && _compress->isDeflate && _compress->isInflate;
+}
+
+
+void  ArnSync::startDeflate()
+{
+#ifdef ARN_ZLIB
+    if (!_compress)
+        _compress = new ArnSyncCompress;
+    if (_compress->isDeflate)  return;
+
+    z_stream&  zs = _compress->deflateStream;
+    zs.zalloc = Z_NULL;
+    zs.zfree  = Z_NULL;
+    zs.opaque = Z_NULL;
+    _compress->isDeflate = deflateInit( &zs, COMPRESS_LEVEL) == Z_OK;
+#endif
+}
+
+
+void  ArnSync::startInflate()
+{
+#ifdef ARN_ZLIB
+    if (!_compress)
+        _compress = new ArnSyncCompress;
+    if (_compress->isInflate)  return;
+
+    z_stream&  zs = _compress->inflateStream;
+    zs.zalloc   = Z_NULL;
+    zs.zfree    = Z_NULL;
+    zs.opaque   = Z_NULL;
+    zs.next_in  = Z_NULL;
+    zs.avail_in = 0;
+    _compress->isInflate = inflateInit( &zs) == Z_OK;
+#endif
+}
+
+
+void  ArnSync::stopCompress()
+{
+    _isDeflatePending = false;
+    _isInflatePending = false;
+    if (!_compress)  return;
+
+#ifdef ARN_ZLIB
+    if (_compress->isDeflate)
+        deflateEnd( &_compress->deflateStream);
+    if (_compress->isInflate)
+        inflateEnd( &_compress->inflateStream);
+#endif
+    delete _compress;
+    _compress = arnNullptr;
+}
+
+
+QByteArray  ArnSync::makeRecord( const XStringMap& xsMap)  const
+{
+    if (!_isBinFrame)  return xsMap.toXString();
+
+    if (isRemoteVerMin( 6, 1) && xsMap.keyRef(0).isEmpty()) {
+        int  cmd = commandCode( xsMap.valueRef(0));
+        if (cmd != Command::Unknown)  // Command name is replaced by its code
+            return xsMap.toBinary( quint32( cmd));
+    }
+    return xsMap.toBinary();
+}
+
+
+bool  ArnSync::loadRecord( XStringMap& xsMap, const QByteArray& rec)  const
+{
+    return _isBinFrame ? xsMap.fromBinary( rec.constData(), rec.size()) : xsMap.fromXString( rec);
+}
+
+
+/// Change record format, already queued pipe records are recoded
+void  ArnSync::setBinFrame( bool isBinFrame)
+{
+    if (isBinFrame == _isBinFrame)  return;
+
+    foreach (FluxRec* fluxRec, _fluxPipeQueue) {
+        loadRecord( _syncMap, fluxRec->xString);
+        fluxRec->xString = isBinFrame ? _syncMap.toBinary() : _syncMap.toXString();
+    }
+    _isBinFrame = isBinFrame;
 }
 
 
@@ -346,11 +801,19 @@ uint ArnSync::remoteVer(uint index)
 }
 
 
+bool  ArnSync::isRemoteVerMin( uint major, uint minor)  const
+{
+    return (_remoteVer[0] > major) || ((_remoteVer[0] == major) && (_remoteVer[1] >= minor));
+}
+
+
 /// Common setup of ItemNet for both server and client
 void  ArnSync::setupItemNet( ArnItemNet* itemNet, uint netId)
 {
     itemNet->setNetId( netId);
     _itemNetMap.insert( netId, itemNet);
+    if (!_isClientSide)
+        addTreeEar( itemNet);
 
     itemNet->setEventHandler( this);
 
@@ -371,6 +834,22 @@ void  ArnSync::itemValueUpdater( const ArnLinkHandle& handleData, const QByteArr
 
     if (itemNet->isLeadValueUpdate())
         addToFluxQue( handleData, valueData, itemNet);
+    else if (handleData.has( ArnLinkHandle::Batch))
+        moveToFluxBatch( handleData, valueData, itemNet);
+}
+
+
+/// An item already queued is moved into the transaction, it must not be sent ahead of it
+void  ArnSync::moveToFluxBatch( const ArnLinkHandle& handleData, const QByteArray* valueData,
+                                ArnItemNet* itemNet)
+{
+    if (itemNet->isPipeMode() || !isRemoteVerMin( 5, 1))  return;
+    if (itemNet->batchId() == handleData.valueRef( ArnLinkHandle::Batch).toUInt())  return;
+
+    if (!_fluxItemQueue.removeOne( itemNet) && !_fluxPrioQueue.removeOne( itemNet))
+        return;  // Not queued, i.e. being sent now
+
+    addToFluxQue( handleData, valueData, itemNet);
 }
 
 
@@ -408,7 +887,7 @@ ArnItemNet*  ArnSync::newNetItem( const QString& path,
     if (_itemNetMap.contains( netId)) {  // Item is already synced by this client
         if (isNewPtr) {  // Allow duplicate ref, indicate this is not new
             delete itemNet;
-            itemNet = _itemNetMap.value( netId, arnNullptr);
+            itemNet = _itemNetMap.value( netId);
             itemNet->addSyncMode( syncMode, true);
             *isNewPtr = false;
             return itemNet;
@@ -463,6 +942,40 @@ void  ArnSync::setSessionHandler( void* sessionHandler)
 }
 
 
+/// Getters of info and statistics will be called from other threads, e.g. session in an I/O thread
+void  ArnSync::setThreadedStat()
+{
+    if (!_statMutex)
+        _statMutex = new QMutex;
+}
+
+
+/// Records are passed in shared memory instead of the socket, which still tells when closed
+void  ArnSync::setShm( ArnSyncShm* shm)
+{
+    if (_shm) {
+        _shm->disconnect( this);
+        _shm->deleteLater();
+    }
+    _shm = shm;
+    if (!_shm)  return;
+
+    _shm->setParent( this);
+    connect( _shm, SIGNAL(readyRead()), this, SLOT(socketInput()));
+    connect( _shm, SIGNAL(bytesWritten(qint64)), this, SLOT(sendNext()));
+    connect( _shm, SIGNAL(broken()), this, SLOT(shmBroken()));
+    _shm->start();
+}
+
+
+void  ArnSync::shmBroken()
+{
+    ArnM::errorLog( QString(tr("Shared memory ring out of range, closing session")), ArnError::RecUnknown);
+    _dataRemain.clear();
+    _socket->disconnectFromHost();
+}
+
+
 void  ArnSync::setToRemotePathCB( ArnSync::ConVertPathCB toRemotePathCB)
 {
     _toRemotePathCB = toRemotePathCB;
@@ -483,24 +996,35 @@ void  ArnSync::setWhoIAm( const QByteArray& whoIAm)
 }
 
 
+/// Getters of session info and statistics can be called from other threads
 QByteArray  ArnSync::remoteWhoIAm()  const
 {
+    QMutexLocker  locker( _statMutex);
     return _remoteWhoIAm;
 }
 
 
 QString  ArnSync::loginUserName()  const
 {
+    QMutexLocker  locker( _statMutex);
     return _loginUserName;
 }
 
 
 Arn::Allow  ArnSync::getAllow()  const
 {
+    QMutexLocker  locker( _statMutex);
     return _allow;
 }
 
 
+void  ArnSync::setAllow( Arn::Allow allow)
+{
+    QMutexLocker  locker( _statMutex);
+    _allow = allow;
+}
+
+
 void  ArnSync::close()
 {
     // qDebug() << "close:";
@@ -530,6 +1054,7 @@ void  ArnSync::clearNonPipeQueues()
     _syncQueue.clear();
     _modeQueue.clear();
     _fluxItemQueue.clear();
+    _fluxPrioQueue.clear();
 }
 
 
@@ -561,6 +1086,7 @@ void  ArnSync::setRemoteVerOnce( const QByteArray& remVer)
     _commandMap.setOptions( xop);
     _replyMap.setOptions( xop);
     _syncMap.setOptions( xop);
+    _fluxBatchMap.setOptions( xop);
 }
 
 
@@ -584,6 +1110,9 @@ bool  ArnSync::isFreePath( const QString& path)  const
 
 int  ArnSync::checkEncryptPolicy()  const
 {
+    if (_shm)  // Records are not passing the socket
+        return (_encryptPol == Arn::EncryptPolicy::MustHave)
+            || (_remoteEncryptPol == Arn::EncryptPolicy::MustHave) ? -1 : 0;
     if ((_encryptPol == Arn::EncryptPolicy::MustHave) && (_remoteEncryptPol == Arn::EncryptPolicy::Refuse))
         return -1;  // Encryption disagree
     if ((_encryptPol == Arn::EncryptPolicy::Refuse) && (_remoteEncryptPol == Arn::EncryptPolicy::MustHave))
@@ -599,28 +1128,71 @@ int  ArnSync::checkEncryptPolicy()  const
 
 void  ArnSync::socketInput()
 {
-    _dataReadBuf.resize( int(_socket->bytesAvailable()));
-    int nbytes = int(_socket->read( _dataReadBuf.data(), qint64(_dataReadBuf.size())));
-    if (nbytes <= 0)  return; // No bytes / error
-    if (_isClosed)  return;
+    int  oldSize = _dataRemain.size();
+    int  avail   = _shm ? _shm->bytesAvailable() : int(_socket->bytesAvailable());
+    if (_compress && _compress->isInflate) {  // Compressed data is read to buf
+        QByteArray&  buf = _compress->buf;
+        buf.resize( avail);
+        int nbytes = transportRead( buf.data(), avail);
+        if (nbytes <= 0)  return; // No bytes / error
+        if (_isClosed)  return;
 
-    _dataReadBuf.resize( nbytes);
-    _dataRemain += _dataReadBuf;
-    _trafficIn  += uint( nbytes);
+        addTrafficIn( nbytes);
+        if (!inflateAppend( buf.constData(), nbytes)) {
+            ArnM::errorLog( QString(tr("Decompress received data failed")), ArnError::RecUnknown);
+            _dataRemain.clear();
+            _socket->disconnectFromHost();
+            return;
+        }
+    }
+    else {
+        _dataRemain.resize( oldSize + avail);  // Read directly after not yet parsed data
+        int nbytes = transportRead( _dataRemain.data() + oldSize, avail);
+        _dataRemain.resize( oldSize + qMax( nbytes, 0));
+        if (nbytes <= 0)  return; // No bytes / error
+        if (_isClosed) {
+            _dataRemain.resize( oldSize);
+            return;
+        }
+
+        addTrafficIn( nbytes);
+    }
+
+    //// Records are parsed in place, consumed data is removed once after the loop
+    int  readPos = 0;
+    forever {
+        const char*  data     = _dataRemain.constData() + readPos;
+        int          dataSize = _dataRemain.size() - readPos;
+        if (_isBinFrame) {  // Length prefixed binary frame
+            if (dataSize < BINFRAME_HEADSIZE)  break;
+            quint32  frameLen = qFromLittleEndian<quint32>( reinterpret_cast<const uchar*>( data));
+            if (frameLen > BINFRAME_MAXSIZE) {
+                ArnM::errorLog( QString(tr("Binary frame too big: size=")) + QString::number( frameLen),
+                                ArnError::RecUnknown);
+                _dataRemain.clear();
+                _socket->disconnectFromHost();
+                return;
+            }
+            int  recEnd = BINFRAME_HEADSIZE + int( frameLen);
+            if (dataSize < recEnd)  break;  // Wait for rest of frame
 
-    QByteArray  xString;
-    int pos;
-    while ((pos = _dataRemain.indexOf("\n")) >= 0) {
-        // Set xString to string before \n
-        xString.resize(0);
-        xString.append( _dataRemain.constData(), pos);
-        _dataRemain.remove(0, pos + 1);     // Set remain to string after \n
+            _commandMap.fromBinary( data + BINFRAME_HEADSIZE, int( frameLen));
+            readPos += recEnd;  // Set cursor to data after frame
+            if (Arn::debugRecInOut)  qDebug() << "Rec-in(bin): " << _commandMap.toXString();
+        }
+        else {
+            const char*  eol = static_cast<const char*>( memchr( data, '\n', size_t( dataSize)));
+            if (!eol)  break;
+            int  lineLen = int( eol - data);
+            readPos += lineLen + 1;  // Set cursor to string after \n
 
-        xString.replace('\r', "");         // Remove any \r
-        _commandMap.fromXString( xString); // Load command Map
+            if ((lineLen > 0) && (data[ lineLen - 1] == '\r'))  // Remove \r
+                --lineLen;
+            _commandMap.fromXString( data, lineLen);  // Load command Map
+            if (Arn::debugRecInOut)  qDebug() << "Rec-in: " << QByteArray( data, lineLen);
+        }
         _replyMap.clear();                  // Reset reply Map
 
-        if (Arn::debugRecInOut)  qDebug() << "Rec-in: " << xString;
         doCommands();
 
         if (_replyMap.size()) {
@@ -628,80 +1200,140 @@ void  ArnSync::socketInput()
             // _replySendingCount++;
             // cout << "REPLY: |" << _replyMap.toXString() << "|" << endl;
         }
+        if (_isBinFramePending) {  // Reply was the last text record
+            _isBinFramePending = false;
+            setBinFrame( true);
+        }
+        if (_isDeflatePending) {  // Reply was the last uncompressed record
+            _isDeflatePending = false;
+            startDeflate();
+        }
+        if (_isInflatePending) {  // Received data after this record is compressed
+            _isInflatePending = false;
+            QByteArray  rawTail = _dataRemain.mid( readPos);
+            _dataRemain.resize( readPos);
+            startInflate();
+            if (!inflateAppend( rawTail.constData(), rawTail.size())) {
+                ArnM::errorLog( QString(tr("Decompress received data failed")), ArnError::RecUnknown);
+                _dataRemain.clear();
+                _socket->disconnectFromHost();
+                return;
+            }
+        }
+    }
+    if (_statMutex)  _statMutex->lock();
+    _trafficInRaw += quint64( readPos);
+    if (_statMutex)  _statMutex->unlock();
+    _dataRemain.remove(0, readPos);  // Only a partial record can remain
+}
+
+
+/// Command codes are sent in binary frames, only append to this table
+const ArnSync::CommandInfo  ArnSync::_commandTab[ ArnSync::Command::N] = {
+    {"",        arnNullptr},  // Unknown
+    {"flux",    &ArnSync::doCommandFlux},
+    {"fluxb",   &ArnSync::doCommandFluxBatch},
+    {"atomop",  &ArnSync::doCommandAtomOp},
+    {"event",   &ArnSync::doCommandEvent},
+    {"get",     &ArnSync::doCommandGet},
+    {"set",     &ArnSync::doCommandSet},
+    {"sync",    &ArnSync::doCommandSync},
+    {"mode",    &ArnSync::doCommandMode},
+    {"nosync",  &ArnSync::doCommandNoSync},
+    {"destroy", &ArnSync::doCommandDelete},  // Legacy: Obsolete, will be phased out
+    {"delete",  &ArnSync::doCommandDelete},
+    {"message", &ArnSync::doCommandMessage},
+    {"ls",      &ArnSync::doCommandLs},
+    {"info",    &ArnSync::doCommandInfo},
+    {"Rinfo",   &ArnSync::doCommandRInfo},
+    {"ver",     &ArnSync::doCommandVer},
+    {"Rver",    &ArnSync::doCommandRVer},
+    {"login",   &ArnSync::doCommandLogin},
+    {"exit",    arnNullptr},
+    {"err",     arnNullptr},
+    {"Rget",    arnNullptr},
+    {"Rset",    arnNullptr},
+    {"Rls",     arnNullptr},
+    {"syncb",   &ArnSync::doCommandSyncBatch}
+};
+
+
+QHash<QByteArray,int>  ArnSync::makeCommandHash()
+{
+    QHash<QByteArray,int>  cmdHash;
+    for (int i = Command::Unknown + 1; i < Command::N; ++i) {
+        cmdHash.insert( QByteArray( _commandTab[i].name), i);
+    }
+    return cmdHash;
+}
+
+
+int  ArnSync::commandCode( const QByteArray& command)
+{
+    static const QHash<QByteArray,int>  cmdHash = makeCommandHash();
+
+    return cmdHash.value( command, Command::Unknown);
+}
+
+
+Arn::XStringMap  ArnSync::commandStat()  const
+{
+    QMutexLocker  locker( _statMutex);
+    XStringMap  xsm;
+    for (int i = 0; i < Command::N; ++i) {
+        if (!_commandCount[i])  continue;
+
+        xsm.add( i == Command::Unknown ? "unknown" : _commandTab[i].name,
+                 QByteArray::number( _commandCount[i]));
     }
+    return xsm;
+}
+
+
+void  ArnSync::countCommand( int cmd)
+{
+    QMutexLocker  locker( _statMutex);
+    ++_commandCount[ cmd];
 }
 
 
 void  ArnSync::doCommands()
 {
     uint stat = ArnError::Ok;
+    int  cmd;
+    const QByteArray&  cmdField = _commandMap.valueRef(0);
+    if (_isBinFrame && !cmdField.isEmpty() && (cmdField.at(0) >= '0') && (cmdField.at(0) <= '9')) {
+        cmd = cmdField.toInt();  // Compact command code
+        if ((cmd <= Command::Unknown) || (cmd >= Command::N))
+            cmd = Command::Unknown;
+        else  // Name is restored for forwarded records
+            _commandMap.set( 0, QByteArray::fromRawData( _commandTab[ cmd].name,
+                                                        int( strlen( _commandTab[ cmd].name))));
+    }
+    else {
+        cmd = commandCode( cmdField);
+    }
     QByteArray command = _commandMap.value(0);
+    countCommand( cmd);
 
     if (_needEncrypted && !_socket->isEncrypted()) {
-        if ((command != "ver") && (command != "Rver") && (command != "info") && (command != "Rinfo")
-        &&  (command != "exit")) {
+        if ((cmd != Command::Ver) && (cmd != Command::RVer) && (cmd != Command::Info) && (cmd != Command::RInfo)
+        &&  (cmd != Command::Exit)) {
             stat = ArnError::NeedEncrypted;
         }
     }
 
     if (stat == ArnError::Ok) {
         /// Received commands
-        if (command == "flux") {
-            stat = doCommandFlux();
-        }
-        else if (command == "atomop") {
-            stat = doCommandAtomOp();
-        }
-        else if (command == "event") {
-            stat = doCommandEvent();
-        }
-        else if (command == "get") {
-            stat = doCommandGet();
-        }
-        else if (command == "set") {
-            stat = doCommandSet();
-        }
-        else if (command == "sync") {
-            stat = doCommandSync();
-        }
-        else if (command == "mode") {
-            stat = doCommandMode();
+        CommandFunc  cmdFunc = _commandTab[ cmd].func;
+        if (cmdFunc) {
+            stat = (this->*cmdFunc)();
         }
-        else if (command == "nosync") {
-            stat = doCommandNoSync();
-        }
-        else if (command == "destroy") {  // Legacy: Obsolete, will be phased out
-            stat = doCommandDelete();
-        }
-        else if (command == "delete") {
-            stat = doCommandDelete();
-        }
-        else if (command == "message") {
-            stat = doCommandMessage();
-        }
-        else if (command == "ls") {
-            stat = doCommandLs();
-        }
-        else if (command == "info") {
-            stat = doCommandInfo();
-        }
-        else if (command == "Rinfo") {
-            stat = doCommandRInfo();
-        }
-        else if (command == "ver") {
-            stat = doCommandVer();
-        }
-        else if (command == "Rver") {
-            stat = doCommandRVer();
-        }
-        else if (command == "login") {
-            stat = doCommandLogin();
-        }
-        else if (command == "exit") {
+        else if (cmd == Command::Exit) {
             _socket->disconnectFromHost();
         }
         /// Error for Server or Client
-        else if (command == "err") {
+        else if (cmd == Command::Err) {
             qDebug() << "REC-ERR: |" << _commandMap.toXString() << "|";
         }
         else if (command.startsWith('R'));  // No error on unhandled R-commands
@@ -742,9 +1374,11 @@ void  ArnSync::startLogin()
 void  ArnSync::loginToArn( const QString& userName, const QString& passwordHash, Arn::Allow allow)
 {
     //// Client side
+    if (_statMutex)  _statMutex->lock();
     _loginUserName = userName;
+    if (_statMutex)  _statMutex->unlock();
     _loginPwHash   = passwordHash;
-    _allow         = allow;
+    setAllow( allow);
 
     loginToArn();
 }
@@ -830,19 +1464,22 @@ uint  ArnSync::doCommandLogin()
         QByteArray  userClient    = _commandMap.value("user");
         QByteArray  pwHashXClient = _commandMap.value("pass");
         QByteArray  pwHashXServer;
+        if (_statMutex)  _statMutex->lock();
         _loginUserName = QString::fromUtf8( userClient.constData(), userClient.size());
+        if (_statMutex)  _statMutex->unlock();
 
         int stat = 0;
-        _allow = Arn::Allow::None;  // Deafult no access
+        Arn::Allow  allow = Arn::Allow::None;  // Deafult no access
         const ArnSyncLogin::AccessSlot*  accSlot = _arnLogin->findAccess( userClient);
         if (accSlot) {
             QByteArray  pwHashX = ArnSyncLogin::pwHashXchg( _loginSalt1, _loginSalt2, accSlot->pwHash);
             if (pwHashXClient == pwHashX) {
-                _allow        = accSlot->allow;
+                allow         = accSlot->allow;
                 pwHashXServer = ArnSyncLogin::pwHashXchg( _loginSalt2, _loginSalt1, accSlot->pwHash);
                 stat          = 1;
             }
         }
+        setAllow( allow);
 
         XStringMap  xsm;
         xsm.add("stat", QByteArray::number( stat));
@@ -910,11 +1547,53 @@ uint  ArnSync::doCommandLogin()
 
 void  ArnSync::getTraffic( quint64& in, quint64& out)  const
 {
+    QMutexLocker  locker( _statMutex);
     in  = _trafficIn;
     out = _trafficOut;
 }
 
 
+void  ArnSync::getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const
+{
+    QMutexLocker  locker( _statMutex);
+    in     = _trafficIn;
+    out    = _trafficOut;
+    inRaw  = _trafficInRaw;
+    outRaw = _trafficOutRaw;
+}
+
+
+void  ArnSync::getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const
+{
+    QMutexLocker  locker( _statMutex);
+    writes     = _writeBatchCount;
+    records    = _writeBatchRecords;
+    maxRecords = _writeBatchMaxRec;
+}
+
+
+void  ArnSync::getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const
+{
+    int  i = isPrio ? 1 : 0;
+    QMutexLocker  locker( _statMutex);
+    count     = _queueDelayCount[i];
+    totalUsec = _queueDelaySum[i];
+    maxUsec   = _queueDelayMax[i];
+}
+
+
+void  ArnSync::addQueueDelay( bool isPrio, qint64 queueTime)
+{
+    int  i = isPrio ? 1 : 0;
+    qint64  delay = _queueClock.nsecsElapsed() / 1000 - queueTime;
+    QMutexLocker  locker( _statMutex);
+    ++_queueDelayCount[i];
+    _queueDelaySum[i] += quint64( delay);
+    if (delay > _queueDelayMax[i])
+        _queueDelayMax[i] = delay;
+}
+
+
 uint  ArnSync::doCommandSync()
 {
     if (_isClientSide)  return ArnError::RecNotExpected;
@@ -922,11 +1601,13 @@ uint  ArnSync::doCommandSync()
     QByteArray   path = _commandMap.value("path");
     QByteArray  smode = _commandMap.value("smode");
     uint        netId = _commandMap.value("id").toUInt();
+    uint          lid = _commandMap.value("lid").toUInt();
+    quint32        uc = _commandMap.value("uc").toUInt();
     if (!_allow.isAny( _allow.ReadWrite) && !isFreePath( path))  return ArnError::OpNotAllowed;
 
     if (_itemNetMap.contains( netId)) {  // Item is already synced by this server session
         //// Remove old syncing item
-        ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+        ArnItemNet*  itemNet = _itemNetMap.value( netId);
         qDebug() << "ArnSync CommandSync Item already synced: path=" << itemNet->path();
         removeItemNetRefs( itemNet);
         delete itemNet;
@@ -954,17 +1635,52 @@ uint  ArnSync::doCommandSync()
     bool  isBlockedValue = ((itemNet->type() == Arn::DataType::Null) && (_remoteVer[0] < 3)) ||
                            itemNet->isPipeMode() ||
                            itemNet->isFolder();
-    if (!isBlockedValue && !(itemNet->isMasterAtStart())) {
+    // Resumed client already has the current value
+    bool  isResumedValue = lid && (lid == itemNet->linkId()) && (uc == itemNet->valueVersion());
+    if (!isBlockedValue && !isResumedValue && !(itemNet->isMasterAtStart())) {
         // Only send non blocked Value to non startMaster
         itemNet->setSyncFlux( true);
         itemNet->setSaveFlux( itemNet->isSaveMode());
-        itemValueUpdater( ArnLinkHandle::null(), arnNullptr, itemNet); // Make server send the current value to client
+        if (_syncBatchId) {  // Initial values of a bulk sync are sent as one batch
+            ArnLinkHandle  batchHandle;
+            batchHandle.add( ArnLinkHandle::Batch, QVariant( _syncBatchId));
+            itemValueUpdater( batchHandle, arnNullptr, itemNet);
+        }
+        else
+            itemValueUpdater( ArnLinkHandle::null(), arnNullptr, itemNet); // Make server send the current value to client
     }
 
     return ArnError::Ok;
 }
 
 
+/// Sync records of a bulk subscription, paths are relative to a common prefix
+uint  ArnSync::doCommandSyncBatch()
+{
+    if (_isClientSide)  return ArnError::RecNotExpected;
+
+    XStringMap  batchMap( _commandMap);  // _commandMap is reused for each contained sync
+    QByteArray  prefix = batchMap.value("pre");
+    uint  retStat = ArnError::Ok;
+
+    _syncBatchId = ArnLink::newBatchId();
+    int  batchSize = batchMap.size();
+    for (int i = 1; i < batchSize; ++i) {
+        if (batchMap.key(i) != "s")  continue;
+
+        loadRecord( _commandMap, batchMap.value(i));
+        _commandMap.set("path", prefix + _commandMap.value("path"));
+        countCommand( Command::Sync);
+        uint  stat = doCommandSync();
+        if (stat != ArnError::Ok)
+            retStat = stat;
+    }
+    _syncBatchId = 0;
+
+    return retStat;
+}
+
+
 /// Can be called booth for remote and local monitoring
 void  ArnSync::setupMonitorItem(ArnItemNet *itemNet)
 {
@@ -994,7 +1710,7 @@ uint  ArnSync::doCommandMode()
     uint  netId = _commandMap.value("id").toUInt();
     QByteArray  data = _commandMap.value("data");
 
-    ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+    ArnItemNet*  itemNet = _itemNetMap.value( netId);
     if (!itemNet) {
         return ArnError::NotFound;
     }
@@ -1009,7 +1725,7 @@ uint  ArnSync::doCommandNoSync()
     //// Single NoSync with id
     uint  netId = _commandMap.value("id").toUInt();
     if (netId) {
-        ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+        ArnItemNet*  itemNet = _itemNetMap.value( netId);
         if (!itemNet) {  // Not existing item is ok, maybe destroyed before sync
             return ArnError::Ok;
         }
@@ -1023,7 +1739,7 @@ uint  ArnSync::doCommandNoSync()
     QString   path = _commandMap.valueString("path");
     QList<ArnItemNet*>  noSyncList;
     // qDebug() << "ArnSync-noSync: path=" << path;
-    foreach (ArnItemNet* itemNet, _itemNetMap) {
+    foreach (ArnItemNet* itemNet, _itemNetMap.values()) {
         if (itemNet->path().startsWith( path)) {
             noSyncList += itemNet;
             // qDebug() << "ArnSync-noSync: Add noSyncList path=" << itemNet->path();
@@ -1063,7 +1779,7 @@ uint  ArnSync::doCommandFlux()
         handleData.add( ArnLinkHandle::SeqNo,
                         QVariant( seq.toInt()));
 
-    ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+    ArnItemNet*  itemNet = _itemNetMap.value( netId);
     if (!itemNet) {
         return ArnError::NotFound;
     }
@@ -1081,17 +1797,51 @@ uint  ArnSync::doCommandFlux()
             itemNet->setEchoSeq( echoSeq);
         bool  isIgnoreSame = isOnlyEcho;
         itemNet->arnImport( data, isIgnoreSame, handleData);
+        if (_isClientSide) {
+            QByteArray  uc = _commandMap.value("uc");
+            if (!uc.isEmpty()) {
+                uint  lid = _commandMap.value("lid").toUInt();
+                itemNet->setRemoteVersion( lid ? lid : itemNet->remoteLinkId(), uc.toUInt());
+            }
+        }
     }
-    else if (_isClientSide && isNullBlocked && isSyncFlux
-         && (itemNet->type() != Arn::DataType::Null)) {
-        // Server only had Null, use Client non Null
-        itemNet->setSyncFlux( true);  // Part of the initial sync process
-        itemValueUpdater( ArnLinkHandle::null(), arnNullptr, itemNet);  // Make client send the current value to server
+    else if (_isClientSide) {
+        itemNet->setRemoteVersion( 0, 0);  // Remote value not taken, can't be resumed
+        if (isNullBlocked && isSyncFlux && (itemNet->type() != Arn::DataType::Null)) {
+            // Server only had Null, use Client non Null
+            itemNet->setSyncFlux( true);  // Part of the initial sync process
+            itemValueUpdater( ArnLinkHandle::null(), arnNullptr, itemNet);  // Make client send the current value to server
+        }
     }
     return ArnError::Ok;
 }
 
 
+/// Flux records of one remote transaction, applied as a local transaction
+uint  ArnSync::doCommandFluxBatch()
+{
+    if (!_allow.is( _allow.Write))  return ArnError::OpNotAllowed;
+
+    XStringMap  batchMap( _commandMap);  // _commandMap is reused for each contained flux
+    uint  retStat = ArnError::Ok;
+
+    ArnLink::beginTransaction();
+    int  batchSize = batchMap.size();
+    for (int i = 1; i < batchSize; ++i) {
+        if (batchMap.key(i) != "f")  continue;
+
+        loadRecord( _commandMap, batchMap.value(i));
+        countCommand( Command::Flux);
+        uint  stat = doCommandFlux();
+        if (stat != ArnError::Ok)
+            retStat = stat;
+    }
+    ArnLink::endTransaction();
+
+    return retStat;
+}
+
+
 uint ArnSync::doCommandAtomOp()
 {
     if (!_allow.is( _allow.Write))  return ArnError::OpNotAllowed;
@@ -1103,7 +1853,7 @@ uint ArnSync::doCommandAtomOp()
 
     ArnAtomicOp  op = ArnAtomicOp::fromInt(
                 ArnAtomicOp::txt().getEnumVal( opStr.constData(), ArnAtomicOp::None, ArnAtomicOp::NsCom));
-    ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+    ArnItemNet*  itemNet = _itemNetMap.value( netId);
     if (!itemNet) {
         // qDebug() << "doCommandAtomOp NotFound xs:" << _commandMap.toXString();
         return ArnError::NotFound;
@@ -1144,7 +1894,7 @@ uint  ArnSync::doCommandEvent()
 
     int  type = ArnMonEventType::txt().getEnumVal( typeStr.constData(),
                                                    ArnMonEventType::None, ArnMonEventType::NsCom);
-    ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+    ArnItemNet*  itemNet = _itemNetMap.value( netId);
     if (!itemNet) {
         if (type == ArnMonEventType::ItemDeleted)  return ArnError::Ok;  // Item already deleted
 
@@ -1241,7 +1991,7 @@ uint  ArnSync::doCommandDelete()
     uint  netId    = _commandMap.value("id", "0").toUInt();
 
     if (netId) {
-        ArnItemNet*  itemNet = _itemNetMap.value( netId, arnNullptr);
+        ArnItemNet*  itemNet = _itemNetMap.value( netId);
         if (!itemNet) {  // Not existing item is ok, maybe destroyed before this
             return ArnError::Ok;
         }
@@ -1312,9 +2062,18 @@ uint  ArnSync::doCommandInfo()
         xmOut.addValues( _freePathTab);
         break;
     case InfoType::WhoIAm:
+        if (_statMutex)  _statMutex->lock();
         _remoteWhoIAm = data;
+        if (_statMutex)  _statMutex->unlock();
         xmOut.fromXString( _whoIAm);
         break;
+    case InfoType::Compress:
+        if (isCompressSupported() && (xmIn.value("comp") == "zlib")) {  // Accept compression
+            xmOut.add("comp", "zlib");
+            _isDeflatePending = true;  // Sent after this reply
+            _isInflatePending = true;
+        }
+        break;
     default:;
         // Not supported info-type, send empty data reply.
         // Client will ask all internal types it support. That chain shall not be broken.
@@ -1364,6 +2123,12 @@ uint  ArnSync::doCommandVer()
     }
 
     _replyMap.add(ARNRECNAME, "Rver").add("type", "ArnNetSync").add("ver", ARNSYNCVER);
+    if (isRemoteVerMin( 6, 3))
+        _replyMap.addNum("epoch", uint( serverEpoch()));
+    if (!Arn::offBinFrame && (_commandMap.value("bin") == "1")) {  // Both sides want binary frames
+        _replyMap.add("bin", "1");
+        _isBinFramePending = true;
+    }
     return ArnError::Ok;
 }
 
@@ -1375,6 +2140,9 @@ uint  ArnSync::doCommandRVer()
     //// Client
     if (_state == State::Version) {
         setRemoteVerOnce( _commandMap.value("ver", "1.0"));  // ver key only after version 1.0
+        _remoteEpoch = _commandMap.value("epoch").toUInt();
+        if (_commandMap.value("bin") == "1")  // Server has switched to binary frames
+            setBinFrame( true);
         if (_remoteVer[0] >= 2) {
             setState( State::Info);
             _curInfoType = InfoType::Start;
@@ -1436,13 +2204,20 @@ void  ArnSync::connected()
     _isConnected      = true;
     _remoteVer[0]     = 0;  // Mark not set
     _remoteVer[1]     = 0;
+    _remoteEpoch      = 0;
     _remoteAllow      = Arn::Allow::None;
     _remoteEncryptPol = Arn::EncryptPolicy::Refuse;  // Default legacy, encryption not available remote
     _needEncrypted    = false;
+    _isBinFramePending = false;
+    setBinFrame( false);  // Always start with text records
+    stopCompress();       // and uncompressed
+    _dataRemain.clear();
 
     setState( State::Version);
     XStringMap  xsm;
     xsm.add(ARNRECNAME, "ver").add("type", "ArnNetSync").add("ver", ARNSYNCVER);
+    if (!Arn::offBinFrame)
+        xsm.add("bin", "1");
     sendXSMap( xsm);
 }
 
@@ -1488,17 +2263,18 @@ void  ArnSync::disConnected()
     _isSending   = false;
 
     if (_isClientSide) {  // Client
+        setShm( arnNullptr);
         if (_isClosed) {
             clearAllQueues();
         }
-        foreach (ArnItemNet* itemNet, _itemNetMap) {
+        foreach (ArnItemNet* itemNet, _itemNetMap.values()) {
             itemNet->onConnectStop();
         }
     }
     else {  // Server
         //// Make a list of netId to AutoDestroy
         QList<uint>  destroyList;
-        foreach (ArnItemNet* itemNet, _itemNetMap) {
+        foreach (ArnItemNet* itemNet, _itemNetMap.values()) {
             if (itemNet->isAutoDestroy()) {
                 destroyList += itemNet->netId();
                 // qDebug() << "Server-disconnect: destroyList path=" << itemNet->path();
@@ -1506,7 +2282,7 @@ void  ArnSync::disConnected()
         }
         //// Destroy from list, twins dissapears in pair
         foreach (uint netId, destroyList) {
-            ArnItemNet* itemNet = _itemNetMap.value( netId, 0);
+            ArnItemNet* itemNet = _itemNetMap.value( netId);
             if (itemNet) {  // if this itemNet still exist
                 // qDebug() << "Server-disconnect: Destroy path=" << itemNet->path();
                 itemNet->destroyLink( true);  // The itemNet will be destroyed (gblobally)
@@ -1525,16 +2301,86 @@ void  ArnSync::removeItemNetRefs( ArnItemNet* itemNet)
     int s;
     s = _itemNetMap.remove( itemNet->netId());
     // qDebug() << "... remove from itemMap num=" << s;
+    if (s && !_isClientSide)
+        removeTreeEar( itemNet);
     s = _syncQueue.removeAll( itemNet);
     // qDebug() << "... remove from syncQueue num=" << s;
     s = _modeQueue.removeAll( itemNet);
     // qDebug() << "... remove from modeQueue num=" << s;
     s = _fluxItemQueue.removeAll( itemNet);
     // qDebug() << "... remove from fluxQueue num=" << s;
+    s = _fluxPrioQueue.removeAll( itemNet);
     ++s;  // Gets rid of warning
 }
 
 
+/// The folder listened to for tree destroy, a folder item listens on itself
+static QString  treeEarPath( ArnItemNet* itemNet)
+{
+    QString  path = itemNet->path();
+    return itemNet->isFolder() ? path : Arn::parentPath( path);
+}
+
+
+/// Server: Only trees having ItemNets in this session are listened to for destroy
+void  ArnSync::addTreeEar( ArnItemNet* itemNet)
+{
+    QString  earPath = treeEarPath( itemNet);
+    TreeEar&  treeEar = _treeEarMap[ earPath];
+    if (!treeEar.refCount) {
+        treeEar.ear = new ArnItemNetEar( this);
+        treeEar.ear->open( earPath);
+        connect( treeEar.ear, SIGNAL(arnTreeDestroyed(QString,bool)),
+                 this, SLOT(doDestroyArnTree(QString,bool)));
+    }
+    ++treeEar.refCount;
+}
+
+
+void  ArnSync::removeTreeEar( ArnItemNet* itemNet)
+{
+    QHash<QString,TreeEar>::iterator  i = _treeEarMap.find( treeEarPath( itemNet));
+    if (i == _treeEarMap.end())  return;
+
+    if (--i.value().refCount > 0)  return;
+
+    //// Deferred, the ear can still have a pending destroy of its own tree
+    i.value().ear->deleteLater();
+    _treeEarMap.erase( i);
+}
+
+
+void  ArnSync::doDestroyArnTree( const QString& path, bool isGlobal)
+{
+    Q_UNUSED(isGlobal)  // Destruction of tree on server will allways be global
+
+    ArnItemNetEar*  ear = qobject_cast<ArnItemNetEar*>( sender());
+    //// Destroy below an ear is sent by the ear in that tree, also avoids duplicates
+    if (!ear || (ear->path() != path))  return;
+
+    //// All ears of a destroyed tree fire, they are collected to only send the topmost
+    if (_treeDestroyPaths.isEmpty())
+        QMetaObject::invokeMethod( this, "sendTreeDestroy", Qt::QueuedConnection);
+    _treeDestroyPaths += path;
+}
+
+
+void  ArnSync::sendTreeDestroy()
+{
+    QStringList  paths = _treeDestroyPaths;
+    _treeDestroyPaths.clear();
+    std::sort( paths.begin(), paths.end());  // Folder paths, an ancestor is before its descendants
+
+    QString  sentPath;
+    foreach (const QString& path, paths) {
+        if (!sentPath.isEmpty() && path.startsWith( sentPath))  continue;  // Included in sent tree
+
+        sendDelete( path);
+        sentPath = path;
+    }
+}
+
+
 void  ArnSync::doArnMonEvent( int type, const QByteArray& data, bool isLocal, ArnItemNet* itemNet)
 {
     if (!itemNet) {
@@ -1582,6 +2428,22 @@ void  ArnSync::doArnMonEvent( int type, const QByteArray& data, bool isLocal, Ar
 }
 
 
+/// Client, compression is asked for if wanted and supported by both sides
+void  ArnSync::doInfoCompressAsk()
+{
+    if (_isCompressWanted && isCompressSupported() && isRemoteVerMin( 6, 2)) {
+        _curInfoType = InfoType::Compress;
+        XStringMap  xmOut;
+        xmOut.add("comp", "zlib");
+        sendInfo( _curInfoType, xmOut.toXString());
+    }
+    else {
+        _curInfoType = InfoType::FreePaths;
+        sendInfo( _curInfoType);
+    }
+}
+
+
 void  ArnSync::doInfoInternal( int infoType, const QByteArray& data)
 {
     //// Only client
@@ -1624,8 +2486,7 @@ void  ArnSync::doInfoInternal( int infoType, const QByteArray& data)
                 sendInfo( _curInfoType, xmOut.toXString());
             }
             else {
-                _curInfoType = InfoType::FreePaths;
-                sendInfo( _curInfoType);
+                doInfoCompressAsk();
             }
         }
         else {  // Encryption policy not satisfied
@@ -1645,6 +2506,13 @@ void  ArnSync::doInfoInternal( int infoType, const QByteArray& data)
         break;
     }
     case InfoType::EncryptRdy:  // Starting point after encryption is active
+        doInfoCompressAsk();
+        break;
+    case InfoType::Compress:
+        if (xmIn.value("comp") == "zlib") {  // Server compress after this reply
+            startDeflate();
+            _isInflatePending = true;
+        }
         _curInfoType = InfoType::FreePaths;
         sendInfo( _curInfoType);
         break;
@@ -1654,7 +2522,9 @@ void  ArnSync::doInfoInternal( int infoType, const QByteArray& data)
         sendInfo( _curInfoType, _whoIAm);
         break;
     case InfoType::WhoIAm:
+        if (_statMutex)  _statMutex->lock();
         _remoteWhoIAm = data;
+        if (_statMutex)  _statMutex->unlock();
 
         setState( State::Login);
         _loginReqCode = 0;
@@ -1695,9 +2565,7 @@ void  ArnSync::addToFluxQue( const ArnLinkHandle& handleData, const QByteArray*
             int i;
             for (i = 0; i < _fluxPipeQueue.size(); ++i) {
                 FluxRec*&  fluxRecQ = _fluxPipeQueue[i];
-                _syncMap.fromXString( fluxRecQ->xString);
-                QString  fluxDataStrQ = _syncMap.valueString("data");
-                if (rx.indexIn( fluxDataStrQ) >= 0) {  // Match
+                if (rx.indexIn( fluxRecMatchData( fluxRecQ)) >= 0) {  // Match
                     // qDebug() << "AddFluxQueue Pipe QOW match: old:"
                     //          << fluxRecQ->xString << "  new:" << fluxRec->xString;
                     _fluxRecPool += fluxRecQ;  // Free item to be replaced
@@ -1732,8 +2600,23 @@ void  ArnSync::addToFluxQue( const ArnLinkHandle& handleData, const QByteArray*
             return;  // Don't send
         }
 
+        bool  isBatch = handleData.has( ArnLinkHandle::Batch) && isRemoteVerMin( 5, 1);
         itemNet->setQueueNum( ++_queueNumCount);
-        _fluxItemQueue.enqueue( itemNet);
+        itemNet->setQueueTime( _queueClock.nsecsElapsed() / 1000);
+        itemNet->setBatchId( isBatch ? handleData.valueRef( ArnLinkHandle::Batch).toUInt() : 0);
+        if (itemNet->isPrio() && !isBatch)  // A transaction is kept in order
+            _fluxPrioQueue.enqueue( itemNet);
+        else
+            _fluxItemQueue.enqueue( itemNet);
+
+        if (isBatch && !_isSending) {
+            // Let the rest of the transaction be queued, it is then sent as one record
+            if (!_isBatchPosted) {
+                _isBatchPosted = true;
+                QMetaObject::invokeMethod( this, "sendNext", Qt::QueuedConnection);
+            }
+            return;
+        }
     }
 
     if (!_isSending) {
@@ -1754,7 +2637,7 @@ void  ArnSync::eventToFluxQue( uint netId, int type, const QByteArray& data)
     _syncMap.add("id", QByteArray::number( netId));
     _syncMap.add("type", typeStr);
     _syncMap.add("data", data);
-    fluxRec->xString += _syncMap.toXString();
+    fluxRec->xString += makeRecord( _syncMap);
     _fluxPipeQueue.enqueue( fluxRec);
 
     if (!_isSending) {
@@ -1777,7 +2660,7 @@ void  ArnSync::atomicOpToFluxQue( int op, const QVariant& arg1, const QVariant&
         _syncMap.add("a1", arg1.toString());
     if (!arg2.isNull())
         _syncMap.add("a2", arg2.toString());
-    fluxRec->xString += _syncMap.toXString();
+    fluxRec->xString += makeRecord( _syncMap);
     _fluxPipeQueue.enqueue( fluxRec);
 
     if (!_isSending) {
@@ -1801,7 +2684,7 @@ void  ArnSync::destroyToFluxQue( ArnItemNet* itemNet)
     const char*  delCmd = (_remoteVer[0] >= 2) ? "delete" : "destroy";
     _syncMap.add(ARNRECNAME, isGlobal ? delCmd : "nosync")
             .add("id", QByteArray::number( itemNet->netId()));
-    fluxRec->xString += _syncMap.toXString();
+    fluxRec->xString += makeRecord( _syncMap);
     _fluxPipeQueue.enqueue( fluxRec);
 
     if (!_isSending) {
@@ -1821,12 +2704,26 @@ ArnSync::FluxRec*  ArnSync::getFreeFluxRec()
         fluxRec = _fluxRecPool.takeLast();
     }
     fluxRec->xString.resize(0);
-    fluxRec->queueNum = ++_queueNumCount;
+    fluxRec->queueNum    = ++_queueNumCount;
+    fluxRec->queueTime   = _queueClock.nsecsElapsed() / 1000;
+    fluxRec->isMatchData = false;
 
     return fluxRec;
 }
 
 
+/// Data of a queued record is only decoded once, also when matched by many overwrites
+const QString&  ArnSync::fluxRecMatchData( FluxRec* fluxRec)
+{
+    if (!fluxRec->isMatchData) {
+        loadRecord( _syncMap, fluxRec->xString);
+        fluxRec->matchData   = _syncMap.valueString("data");
+        fluxRec->isMatchData = true;
+    }
+    return fluxRec->matchData;
+}
+
+
 void  ArnSync::addToModeQue( ArnItemNet* itemNet)
 {
     if (_isClosed)  return;
@@ -1849,7 +2746,8 @@ void  ArnSync::addToModeQue( ArnItemNet* itemNet)
 
 void  ArnSync::sendNext()
 {
-    _isSending = false;
+    _isSending     = false;
+    _isBatchPosted = false;
 
     if (!_isConnected || !_socket->isValid())  return;
     if (_state != State::Normal) {
@@ -1858,45 +2756,85 @@ void  ArnSync::sendNext()
         return;
     }
 
-    ArnItemNet*  itemNet;
-
-    if (!_syncQueue.isEmpty()) {
-        itemNet = _syncQueue.dequeue();
-        sendSyncItem( itemNet);
+    //// Queued records are written together, up to the high-water marks
+    int  recNum = 0;
+    _isWriteBatch = true;
+    while ((recNum < qMax( Arn::writeBatchMaxRecords, 1))
+       &&  (_writeBuf.size() < Arn::writeBatchMaxBytes)) {
+        if (!sendNextRecord())  break;  // Nothing more to send
+        ++recNum;
+    }
+    _isWriteBatch = false;
+
+    if (recNum > 0) {
+        socketWrite( _writeBuf);
+        _writeBuf.resize(0);
+        if (_statMutex)  _statMutex->lock();
+        ++_writeBatchCount;
+        _writeBatchRecords += quint64( recNum);
+        _writeBatchMaxRec   = qMax( _writeBatchMaxRec, recNum);
+        if (_statMutex)  _statMutex->unlock();
         _isSending = true;
     }
-    else if (!_modeQueue.isEmpty()) {
-        itemNet = _modeQueue.dequeue();
-        sendModeItem( itemNet);
-        itemNet->resetDirtyMode();
-        _isSending = true;
+    else {  // Nothing more to send
+        if (_isClosed)
+            closeFinal();
     }
-    else {  // Flux queues - send entity with lowest queue number
-        int  itemQueueNum = _fluxItemQueue.isEmpty() ? _queueNumDone + MAX_BIG_INT : _fluxItemQueue.head()->queueNum();
-        int  pipeQueueNum = _fluxPipeQueue.isEmpty() ? _queueNumDone + MAX_BIG_INT : _fluxPipeQueue.head()->queueNum;
-        int  itemQueueRel = itemQueueNum - _queueNumDone;
-        int  pipeQueueRel = pipeQueueNum - _queueNumDone;
+}
+
+
+/// Sync, mode, prio flux and then flux queues in queue number order, items no longer open are skipped
+bool  ArnSync::sendNextRecord()
+{
+    forever {
+        ArnItemNet*  itemNet;
+
+        if (!_syncQueue.isEmpty()) {
+            itemNet = _syncQueue.dequeue();
+            bool  isBatch = !_syncQueue.isEmpty() && isRemoteVerMin( 6, 4);
+            if (isBatch ? sendSyncBatch( itemNet) : sendSyncItem( itemNet))  return true;
+        }
+        else if (!_modeQueue.isEmpty()) {
+            itemNet = _modeQueue.dequeue();
+            bool  isSent = sendModeItem( itemNet);
+            itemNet->resetDirtyMode();
+            if (isSent)  return true;
+        }
+        else if (!_fluxPrioQueue.isEmpty()) {  // Prio class has strict priority
+            itemNet = _fluxPrioQueue.dequeue();
+            addQueueDelay( true, itemNet->queueTime());
+            bool  isSent = sendFluxItem( itemNet);
+            itemNet->resetDirtyValue();
+            if (isSent)  return true;
+        }
+        else {  // Flux queues - send entity with lowest queue number
+            int  itemQueueNum = _fluxItemQueue.isEmpty() ? _queueNumDone + MAX_BIG_INT : _fluxItemQueue.head()->queueNum();
+            int  pipeQueueNum = _fluxPipeQueue.isEmpty() ? _queueNumDone + MAX_BIG_INT : _fluxPipeQueue.head()->queueNum;
+            int  itemQueueRel = itemQueueNum - _queueNumDone;
+            int  pipeQueueRel = pipeQueueNum - _queueNumDone;
+
+            if ((itemQueueRel >= MAX_BIG_INT) && (pipeQueueRel >= MAX_BIG_INT))  // Flux queues empty
+                return false;
 
-        if ((itemQueueRel < MAX_BIG_INT) || (pipeQueueRel < MAX_BIG_INT)) { // At least 1 flux queue not empty
             if (itemQueueRel < pipeQueueRel) {  // Item flux queue
                 _queueNumDone = itemQueueNum;
 
                 itemNet = _fluxItemQueue.dequeue();
-                sendFluxItem( itemNet);
+                addQueueDelay( false, itemNet->queueTime());
+                bool  isSent = itemNet->batchId() ? sendFluxBatch( itemNet)
+                                                  : sendFluxItem( itemNet);
                 itemNet->resetDirtyValue();
+                if (isSent)  return true;
             }
             else {  // Pipe flux queue
                 _queueNumDone = pipeQueueNum;
 
                 FluxRec*  fluxRec = _fluxPipeQueue.dequeue();
+                addQueueDelay( false, fluxRec->queueTime);
                 _fluxRecPool += fluxRec;
                 send( fluxRec->xString);
+                return true;
             }
-            _isSending = true;
-        }
-        else {  // Nothing more to send
-            if (_isClosed)
-                closeFinal();
         }
     }
 }
@@ -1920,62 +2858,162 @@ QByteArray  ArnSync::makeFluxString( const ArnItemNet* itemNet, const ArnLinkHan
     if (echoSeq >= 0)
         _syncMap.addNum("es", int(echoSeq));
 
+    bool  isSharedData = !valueData && !_isClientSide;
+    quint32  valueVersion = isSharedData ? itemNet->valueVersion() : 0;  // Before export, never newer than value
+    if (isSharedData && isRemoteVerMin( 6, 3)) {  // Version of value for client resume
+        if (itemNet->isSyncFlux())
+            _syncMap.addNum("lid", itemNet->linkId());
+        _syncMap.addNum("uc", uint( valueVersion));
+    }
+
     if (handleData.has( ArnLinkHandle::QueueFindRegexp))
         _syncMap.add("nqrx", handleData.valueRef( ArnLinkHandle::QueueFindRegexp).ARN_ToRegExp().pattern());
     else if (handleData.has( ArnLinkHandle::SeqNo))
         _syncMap.add("seq", QByteArray::number( handleData.valueRef( ArnLinkHandle::SeqNo).toInt()));
 
-    _syncMap.add("data", valueData ? *valueData : itemNet->arnExport());
+    if (!isSharedData) {
+        _syncMap.add("data", valueData ? *valueData : itemNet->arnExport());
+        return makeRecord( _syncMap);
+    }
 
-    return _syncMap.toXString();
+    //// Server, the coded value is the same for all sessions and is appended as the last field
+    QByteArray  fluxString = makeRecord( _syncMap);
+    if (!_isBinFrame)
+        fluxString += ' ';
+    fluxString += sharedFluxDataField( itemNet, valueVersion, _syncMap.options(), _isBinFrame);
+    return fluxString;
 }
 
 
-void  ArnSync::sendFluxItem( const ArnItemNet* itemNet)
+bool  ArnSync::sendFluxItem( const ArnItemNet* itemNet)
 {
-    if (!itemNet || !itemNet->isOpen()) {
-        sendNext();  // Warning: this is recursion while not existing items
-        return;
-    }
+    if (!itemNet || !itemNet->isOpen())  return false;
 
     send( makeFluxString( itemNet, ArnLinkHandle::null(), arnNullptr));
+    return true;
 }
 
 
-void  ArnSync::sendSyncItem( ArnItemNet* itemNet)
+/// Following queued items of the same transaction are sent in one record
+bool  ArnSync::sendFluxBatch( ArnItemNet* itemNet)
 {
-    if (!itemNet  ||  !itemNet->isOpen()) {
-        sendNext();  // Warning: this is recursion while not existing items
-        return;
+    uint  batchId = itemNet->batchId();
+
+    _fluxBatchMap.clear();
+    _fluxBatchMap.add(ARNRECNAME, "fluxb");
+    forever {
+        if (itemNet->isOpen())
+            _fluxBatchMap.add("f", makeFluxString( itemNet, ArnLinkHandle::null(), arnNullptr));
+        itemNet->setBatchId(0);
+        itemNet->resetDirtyValue();
+
+        if (_fluxItemQueue.isEmpty())  break;
+        ArnItemNet*  nextItemNet = _fluxItemQueue.head();
+        if (nextItemNet->batchId() != batchId)  break;
+        int  itemQueueRel = nextItemNet->queueNum() - _queueNumDone;
+        int  pipeQueueRel = _fluxPipeQueue.isEmpty() ? MAX_BIG_INT
+                                                     : _fluxPipeQueue.head()->queueNum - _queueNumDone;
+        if (pipeQueueRel < itemQueueRel)  break;  // Keep order to pipe flux
+
+        _queueNumDone = nextItemNet->queueNum();
+        itemNet = _fluxItemQueue.dequeue();
+        addQueueDelay( false, itemNet->queueTime());
     }
 
+    int  fluxNum = _fluxBatchMap.size() - 1;
+    if (fluxNum <= 0)
+        return false;
+    else if (fluxNum == 1)
+        send( _fluxBatchMap.value(1));  // Single flux, no batch needed
+    else
+        sendXSMap( _fluxBatchMap);
+    return true;
+}
+
+
+bool  ArnSync::sendSyncItem( ArnItemNet* itemNet)
+{
+    if (!itemNet  ||  !itemNet->isOpen())  return false;
+
+    makeSyncMap( itemNet, (*_toRemotePathCB)( _sessionHandler, itemNet->path()));
+
+    if (Arn::debugShareObj)  qDebug() << "Send sync: localPath=" << itemNet->path()
+                                      << ", " << _syncMap.toXString();
+    sendXSMap( _syncMap);
+    return true;
+}
+
+
+/// Following queued items are sent in one record, paths are relative to their common folder
+bool  ArnSync::sendSyncBatch( ArnItemNet* itemNet)
+{
+    QList<ArnItemNet*>  itemList;
+    QStringList  pathList;
+    forever {
+        if (itemNet  &&  itemNet->isOpen()) {
+            itemList += itemNet;
+            pathList += (*_toRemotePathCB)( _sessionHandler, itemNet->path());
+        }
+        if (_syncQueue.isEmpty() || (itemList.size() >= SYNCBATCH_MAXNUM))  break;
+        itemNet = _syncQueue.dequeue();
+    }
+
+    int  itemNum = itemList.size();
+    if (itemNum == 0)  return false;
+    if (itemNum == 1)  return sendSyncItem( itemList.at(0));
+
+    QString  prefix = pathList.at(0);
+    for (int i = 1; i < itemNum; ++i) {
+        const QString&  path = pathList.at(i);
+        int  len = qMin( prefix.size(), path.size());
+        int  j = 0;
+        while ((j < len) && (prefix.at(j) == path.at(j)))
+            ++j;
+        prefix.truncate( j);
+    }
+    prefix.truncate( prefix.lastIndexOf('/') + 1);  // Only whole folders
+
+    XStringMap  batchMap;
+    batchMap.setOptions( _syncMap.options());
+    batchMap.add(ARNRECNAME, "syncb").add("pre", prefix);
+    for (int i = 0; i < itemNum; ++i) {
+        makeSyncMap( itemList.at(i), pathList.at(i).mid( prefix.size()));
+        batchMap.add("s", makeRecord( _syncMap));
+    }
+
+    if (Arn::debugShareObj)  qDebug() << "Send sync batch: items=" << itemNum << " prefix=" << prefix;
+    sendXSMap( batchMap);
+    return true;
+}
+
+
+void  ArnSync::makeSyncMap( ArnItemNet* itemNet, const QString& remotePath)
+{
     _syncMap.clear();
     _syncMap.add(ARNRECNAME, "sync");
-    _syncMap.add("path", (*_toRemotePathCB)( _sessionHandler, itemNet->path()));
+    _syncMap.add("path", remotePath);
     _syncMap.add("id", QByteArray::number( itemNet->netId()));
     QByteArray  smode = itemNet->getSyncModeString();
     if (!smode.isEmpty()) {
         _syncMap.add("smode", smode);
     }
-
-    if (Arn::debugShareObj)  qDebug() << "Send sync: localPath=" << itemNet->path()
-                                      << ", " << _syncMap.toXString();
-    sendXSMap( _syncMap);
+    if (itemNet->isRemoteVersionValid()) {  // Resume, value not changed here
+        _syncMap.addNum("lid", itemNet->remoteLinkId());
+        _syncMap.addNum("uc", uint( itemNet->remoteValueVersion()));
+    }
 }
 
 
-void  ArnSync::sendModeItem( ArnItemNet* itemNet)
+bool  ArnSync::sendModeItem( ArnItemNet* itemNet)
 {
-    if (!itemNet  ||  !itemNet->isOpen()) {
-        sendNext();  // Warning: this is recursion while not existing items
-        return;
-    }
+    if (!itemNet  ||  !itemNet->isOpen())  return false;
 
     _syncMap.clear();
     _syncMap.add(ARNRECNAME, "mode");
     _syncMap.add("id", QByteArray::number( itemNet->netId()));
     _syncMap.add("data", itemNet->getModeString());
     sendXSMap( _syncMap);
+    return true;
 }
 
 
@@ -40,7 +40,11 @@
 #include <QTimer>
 #include <QByteArray>
 #include <QMap>
+#include <QHash>
 #include <QQueue>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QSslError>
 
 #define ARNRECNAME  ""
@@ -48,9 +52,44 @@
 
 class QSslSocket;
 class ArnSyncLogin;
+struct ArnSyncCompress;
+class ArnSyncShm;
 
 
 //! \cond ADV
+//! Synced items of a session by netId, open addressing with linear probing
+/*! netIds are link ids, in a session they are often close to each other but not dense.
+ *  Iteration order is not defined.
+ */
+class ArnItemNetTab
+{
+public:
+    ArnItemNetTab();
+
+    ArnItemNet*  value( uint netId)  const;
+    bool  contains( uint netId)  const;
+    void  insert( uint netId, ArnItemNet* itemNet);
+    int  remove( uint netId);
+    int  size()  const;
+    QList<uint>  keys()  const;
+    QList<ArnItemNet*>  values()  const;
+
+private:
+    struct Slot {
+        uint  netId;
+        ArnItemNet*  itemNet;  // Null if slot is free
+    };
+
+    int  slotIndex( uint netId)  const;
+    void  rehash( int bits);
+
+    QVector<Slot>  _slots;
+    uint  _mask;
+    int  _bits;
+    int  _size;
+};
+
+
 class ArnSync : public QObject
 {
     Q_OBJECT
@@ -84,6 +123,8 @@ public:
             EncryptAsk  = 1101,
             EncryptReq  = 1102,
             EncryptRdy  = 1103,  // Encrypt ready marker
+            //! Negotiate compression of the following traffic
+            Compress    = 1201,
             End                  // End marker
         };
         MQ_DECLARE_ENUM( InfoType)
@@ -102,6 +143,7 @@ public:
     };
 
     typedef QString (*ConVertPathCB)(void* context, const QString& path);
+    typedef uint (ArnSync::*CommandFunc)();
 
     ArnSync( QSslSocket* socket, bool clientSide, QObject *parent);
     ~ArnSync();
@@ -139,6 +181,8 @@ public:
     Arn::EncryptPolicy  encryptPolicy()  const;
     void  setEncryptPolicy( const Arn::EncryptPolicy& pol);
     void  setSessionHandler( void* sessionHandler);
+    void  setShm( ArnSyncShm* shm);
+    void  setThreadedStat();
     void  setToRemotePathCB( ConVertPathCB toRemotePathCB);
     static QString  nullConvertPath( void* context, const QString& path);
     void  setWhoIAm( const QByteArray& whoIAm);
@@ -146,6 +190,13 @@ public:
     QString  loginUserName()  const;
     Arn::Allow  getAllow()  const;
     void  getTraffic( quint64& in, quint64& out)  const;
+    void  getTraffic( quint64& in, quint64& out, quint64& inRaw, quint64& outRaw)  const;
+    static bool  isCompressSupported();
+    void  setCompress( bool isCompress);
+    bool  isCompress()  const;
+    void  getWriteBatchStat( quint64& writes, quint64& records, int& maxRecords)  const;
+    void  getQueueDelayStat( bool isPrio, quint64& count, quint64& totalUsec, qint64& maxUsec)  const;
+    Arn::XStringMap  commandStat()  const;
 
 signals:
     void  replyRecord( Arn::XStringMap& replyMap);
@@ -167,17 +218,70 @@ private slots:
     void  doStartClientEncryption();
     void  disConnected();
     void  socketInput();
+    void  shmBroken();
     void  doLoginSeq0End();
     void  sendNext();
     void  doArnMonEvent( int type, const QByteArray& data, bool isLocal, ArnItemNet* itemNet);
+    void  doDestroyArnTree( const QString& path, bool isGlobal);
+    void  sendTreeDestroy();
 
 private:
     struct FluxRec {
         QByteArray  xString;
+        QString  matchData;  // Decoded data for overwrite matching, valid if isMatchData
+        qint64  queueTime;
         int  queueNum;
+        bool  isMatchData;
+    };
+
+    //! Received record types, code is index in _commandTab
+    struct Command {
+        enum E {
+            Unknown = 0,
+            Flux,
+            FluxBatch,
+            AtomOp,
+            Event,
+            Get,
+            Set,
+            Sync,
+            Mode,
+            NoSync,
+            Destroy,
+            Delete,
+            Message,
+            Ls,
+            Info,
+            RInfo,
+            Ver,
+            RVer,
+            Login,
+            Exit,
+            Err,
+            RGet,
+            RSet,
+            RLs,
+            SyncBatch,  // New codes only added last, the code is sent in binary frames
+            N  // Number of command codes
+        };
+    };
+
+    struct CommandInfo {
+        const char*  name;
+        CommandFunc  func;  // Null if not handled by a doCommand function
     };
 
     void  doInfoInternal( int infoType, const QByteArray& data = QByteArray());
+    void  doInfoCompressAsk();
+    void  socketWrite( const QByteArray& data);
+    void  transportWrite( const QByteArray& data);
+    int  transportRead( char* data, int maxSize);
+    void  addTrafficOut( int rawSize, int size);
+    void  addTrafficIn( int size);
+    bool  inflateAppend( const char* data, int size);
+    void  startDeflate();
+    void  startInflate();
+    void  stopCompress();
     void  startLogin();
     void  startNormalSync();
     void  setupItemNet( ArnItemNet* itemNet, uint netId);
@@ -185,32 +289,52 @@ private:
                             ArnItemNet* itemNet);
     void  itemModeUpdater( ArnItemNet* itemNet);
     FluxRec*  getFreeFluxRec();
+    const QString&  fluxRecMatchData( FluxRec* fluxRec);
+    void  addQueueDelay( bool isPrio, qint64 queueTime);
+    void  countCommand( int cmd);
+    void  setAllow( Arn::Allow allow);
     QByteArray  makeFluxString( const ArnItemNet* itemNet, const ArnLinkHandle& handleData,
                                 const QByteArray* valueData);
     void  addToFluxQue( const ArnLinkHandle& handleData, const QByteArray* valueData,
                         ArnItemNet* itemNet);
+    void  moveToFluxBatch( const ArnLinkHandle& handleData, const QByteArray* valueData,
+                           ArnItemNet* itemNet);
     void  addToModeQue( ArnItemNet* itemNet);
-    void  sendFluxItem( const ArnItemNet* itemNet);
-    void  sendSyncItem( ArnItemNet* itemNet);
-    void  sendModeItem( ArnItemNet* itemNet);
+    bool  sendNextRecord();
+    QByteArray  makeRecord( const Arn::XStringMap& xsMap)  const;
+    bool  loadRecord( Arn::XStringMap& xsMap, const QByteArray& rec)  const;
+    void  setBinFrame( bool isBinFrame);
+    bool  sendFluxItem( const ArnItemNet* itemNet);
+    bool  sendFluxBatch( ArnItemNet* itemNet);
+    bool  sendSyncItem( ArnItemNet* itemNet);
+    bool  sendSyncBatch( ArnItemNet* itemNet);
+    void  makeSyncMap( ArnItemNet* itemNet, const QString& remotePath);
+    bool  sendModeItem( ArnItemNet* itemNet);
     void  sendLogin( int seq, const Arn::XStringMap& xsMap);
     void  eventToFluxQue( uint netId, int type, const QByteArray& data);
     void  atomicOpToFluxQue( int op, const QVariant& arg1, const QVariant& arg2, const ArnItemNet* itemNet);
     void  destroyToFluxQue( ArnItemNet* itemNet);
     void  removeItemNetRefs( ArnItemNet* itemNet);
+    void  addTreeEar( ArnItemNet* itemNet);
+    void  removeTreeEar( ArnItemNet* itemNet);
     void  closeFinal();
     void  clearNonPipeQueues();
     void  clearAllQueues();
     void  setRemoteVerOnce( const QByteArray& remVer);
+    bool  isRemoteVerMin( uint major, uint minor)  const;
     void  setState( State state);
     bool  isFreePath( const QString& path)  const;
     int  checkEncryptPolicy()  const;
 
+    static QHash<QByteArray,int>  makeCommandHash();
+    static int  commandCode( const QByteArray& command);
     void  doCommands();
     uint  doCommandSync();
+    uint  doCommandSyncBatch();
     uint  doCommandMode();
     uint  doCommandNoSync();
     uint  doCommandFlux();
+    uint  doCommandFluxBatch();
     uint  doCommandAtomOp();
     uint  doCommandEvent();
     uint  doCommandSet();
@@ -229,21 +353,30 @@ private:
     void*  _sessionHandler;
     ConVertPathCB  _toRemotePathCB;
 
-    QByteArray  _dataReadBuf;
-    QByteArray  _dataRemain;
+    QByteArray  _dataRemain;  // Received data, not yet parsed records
+    QByteArray  _writeBuf;
     Arn::XStringMap  _commandMap;
     Arn::XStringMap  _replyMap;
     Arn::XStringMap  _syncMap;
+    Arn::XStringMap  _fluxBatchMap;
     Arn::XStringMap  _customMap;
     QStringList  _freePathTab;
     QByteArray  _whoIAm;
     QByteArray  _remoteWhoIAm;
 
-    QMap<uint,ArnItemNet*>  _itemNetMap;
+    ArnItemNetTab  _itemNetMap;  // Looked up for each received record
+
+    struct TreeEar {
+        ArnItemNetEar*  ear;
+        int  refCount;  // Number of ItemNets using this ear
+    };
+    QHash<QString,TreeEar>  _treeEarMap;  // Server: Folder path --> Ear for tree destroy
+    QStringList  _treeDestroyPaths;       // Server: Destroyed ear paths not yet sent
 
     QList<FluxRec*>  _fluxRecPool;
     QQueue<FluxRec*>  _fluxPipeQueue;
     QQueue<ArnItemNet*>  _fluxItemQueue;
+    QQueue<ArnItemNet*>  _fluxPrioQueue;  // Sent before any other flux
 
     QQueue<ArnItemNet*>  _syncQueue;
     QQueue<ArnItemNet*>  _modeQueue;
@@ -255,17 +388,40 @@ private:
     bool  _isConnectStarted;
     bool  _isConnected;
     bool  _isSending;
+    bool  _isBatchPosted;     // Delayed sendNext for queuing a whole transaction batch
+    bool  _isWriteBatch;      // Records are collected in _writeBuf
+    bool  _isBinFrame;        // Records are length prefixed binary XStringMap
+    bool  _isBinFramePending; // Binary frames starts after the current reply
+    bool  _isCompressWanted;
+    bool  _isDeflatePending;  // Compressed sending starts after the current reply
+    bool  _isInflatePending;  // Received data after the current record is compressed
+    ArnSyncCompress*  _compress;
+    ArnSyncShm*  _shm;        // Shared memory transport, null when records use the socket
     bool  _isClosed;
     bool  _isClientSide;      // True if this is the client side of the connection
     bool  _isDemandLogin;
     bool  _needEncrypted;
     uint  _remoteVer[2];
+    quint32  _remoteEpoch;    // Server instance of this connection, 0 = unknown
+    quint32  _resumeEpoch;    // Server instance that remote versions of items refers to
+    uint  _syncBatchId;       // Batch of initial values for a bulk sync, 0 = none
     int  _loginNextSeq;
     int  _loginReqCode;
     uint  _loginSalt1;
     uint  _loginSalt2;
     quint64  _trafficIn;
     quint64  _trafficOut;
+    quint64  _trafficInRaw;   // Before compression
+    quint64  _trafficOutRaw;
+    quint64  _commandCount[ Command::N];  // Received records per command
+    quint64  _writeBatchCount;    // Number of socket writes from sendNext
+    quint64  _writeBatchRecords;  // Number of records in these writes
+    int  _writeBatchMaxRec;       // Max records in one write
+    QElapsedTimer  _queueClock;   // Time base for queue delay statistics
+    quint64  _queueDelayCount[2];  // Per send class, index 1 is Prio
+    quint64  _queueDelaySum[2];    // usec
+    qint64  _queueDelayMax[2];     // usec
+    QMutex*  _statMutex;          // Guards info and statistics read by getters from other threads, null if not
     QString  _loginUserName;
     QString  _loginPwHash;
     QTimer  _loginDelayTimer;
@@ -274,6 +430,8 @@ private:
     Arn::ClientSyncMode  _clientSyncMode;
     Arn::EncryptPolicy  _encryptPol;
     Arn::EncryptPolicy  _remoteEncryptPol;
+
+    static const CommandInfo  _commandTab[ Command::N];
 };
 //! \endcond
 
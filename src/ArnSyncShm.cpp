@@ -0,0 +1,420 @@
+// Copyright (C) 2010-2022 Michael Wiklund.
+// All rights reserved.
+// Contact: arnlib@wiklunden.se
+//
+// This file is part of the ArnLib - Active Registry Network.
+// Parts of ArnLib depend on Qt and/or other libraries that have their own
+// licenses. Usage of these other libraries is subject to their respective
+// license agreements.
+//
+// GNU Lesser General Public License Usage
+// This file may be used under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation and
+// appearing in the file LICENSE_LGPL.txt included in the packaging of this
+// file. In addition, as a special exception, you may use the rights described
+// in the Nokia Qt LGPL Exception version 1.1, included in the file
+// LGPL_EXCEPTION.txt in this package.
+//
+// GNU General Public License Usage
+// Alternatively, this file may be used under the terms of the GNU General Public
+// License version 3.0 as published by the Free Software Foundation and appearing
+// in the file LICENSE_GPL.txt included in the packaging of this file.
+//
+// Other Usage
+// Alternatively, this file may be used in accordance with the terms and conditions
+// contained in a signed written agreement between you and Michael Wiklund.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+//
+
+#include "ArnSyncShm.hpp"
+#include <QSocketNotifier>
+#include <QAtomicInt>
+#include <QDebug>
+#ifdef Q_OS_LINUX
+# include <sys/mman.h>
+# include <sys/eventfd.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+#include <string.h>
+
+#define SHM_MAGIC     0x41524e53  // "ARNS"
+#define SHM_VERSION   1
+#define SHM_CTRLSIZE  4096        // Control block before the ring data
+#define SHM_SETUPFDS  3           // Memory, client wakeup and server wakeup
+
+
+//// Producer and consumer positions are in separate cache lines
+struct ArnSyncShmRing
+{
+    QAtomicInt  head;  // Total bytes written, only changed by producer
+    char  pad1[60];
+    QAtomicInt  tail;  // Total bytes read, only changed by consumer
+    char  pad2[60];
+};
+
+
+//// Start of the shared memory, it is zero filled when made
+struct ArnSyncShmCtrl
+{
+    quint32  magic;
+    quint32  version;
+    qint32  ringSize;
+    char  pad1[52];
+    QAtomicInt  isWaitingData[2];   // Side sleeps until its rx ring is written
+    QAtomicInt  isWaitingSpace[2];  // Side sleeps until its tx ring is read
+    char  pad2[48];
+    ArnSyncShmRing  ring[2];        // Index is the producing side
+};
+
+
+
+ArnSyncShm::ArnSyncShm( int side)
+{
+    _ctrl            = arnNullptr;
+    _rxData          = arnNullptr;
+    _txData          = arnNullptr;
+    _mapSize         = 0;
+    _ringSize        = 0;
+    _side            = side;
+    _memFd           = -1;
+    _wakeFd[0]       = -1;
+    _wakeFd[1]       = -1;
+    _notifier        = arnNullptr;
+    _writtenCount    = 0;
+    _isWrittenPosted = false;
+    _isBroken        = false;
+}
+
+
+ArnSyncShm::~ArnSyncShm()
+{
+    delete _notifier;
+#ifdef Q_OS_LINUX
+    if (_ctrl)
+        ::munmap( _ctrl, size_t( _mapSize));
+    if (_memFd >= 0)
+        ::close( _memFd);
+    for (int i = 0; i < 2; ++i) {
+        if (_wakeFd[i] >= 0)
+            ::close( _wakeFd[i]);
+    }
+#endif
+}
+
+
+bool  ArnSyncShm::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+ArnSyncShm*  ArnSyncShm::create( int ringSize)
+{
+#ifdef Q_OS_LINUX
+    int  size = 4096;
+    while (size < ringSize) {
+        size <<= 1;  // Power of 2, positions are masked
+    }
+
+    ArnSyncShm*  shm = new ArnSyncShm(0);
+    shm->_memFd     = ::memfd_create("ArnSyncShm", MFD_CLOEXEC);
+    shm->_wakeFd[0] = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC);
+    shm->_wakeFd[1] = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((shm->_memFd < 0) || (shm->_wakeFd[0] < 0) || (shm->_wakeFd[1] < 0)
+    ||  (::ftruncate( shm->_memFd, off_t( SHM_CTRLSIZE + 2 * size)) != 0)
+    ||  !shm->map( shm->_memFd, size)) {
+        delete shm;
+        return arnNullptr;
+    }
+
+    shm->_ctrl->ringSize = size;
+    shm->_ctrl->version  = SHM_VERSION;
+    shm->_ctrl->magic    = SHM_MAGIC;
+    return shm;
+#else
+    Q_UNUSED(ringSize)
+    return arnNullptr;
+#endif
+}
+
+
+ArnSyncShm*  ArnSyncShm::receiveSetup( int socketFd)
+{
+#ifdef Q_OS_LINUX
+    int  fds[ SHM_SETUPFDS];
+    char  byte;
+    char  cbuf[ CMSG_SPACE( sizeof fds)];
+    struct iovec  iov;
+    iov.iov_base = &byte;
+    iov.iov_len  = 1;
+    struct msghdr  msg;
+    memset( &msg, 0, sizeof msg);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof cbuf;
+    ssize_t  r;
+    do {
+        r = ::recvmsg( socketFd, &msg, MSG_CMSG_CLOEXEC);
+    } while ((r < 0) && (errno == EINTR));
+
+    struct cmsghdr*  cmsg = CMSG_FIRSTHDR( &msg);
+    if ((r != 1) || !cmsg || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))
+        return arnNullptr;
+    int  fdNum = int( (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    memcpy( fds, CMSG_DATA( cmsg), sizeof(int) * size_t( qMin( fdNum, SHM_SETUPFDS)));
+    if (fdNum != SHM_SETUPFDS) {
+        for (int i = 0; i < qMin( fdNum, SHM_SETUPFDS); ++i) {
+            ::close( fds[i]);
+        }
+        return arnNullptr;
+    }
+
+    ArnSyncShm*  shm = new ArnSyncShm(1);
+    shm->_wakeFd[0] = fds[1];
+    shm->_wakeFd[1] = fds[2];
+    struct stat  st;
+    bool  isOk = (::fstat( fds[0], &st) == 0) && (st.st_size > SHM_CTRLSIZE);
+    int  size = isOk ? int( (st.st_size - SHM_CTRLSIZE) / 2) : 0;
+    isOk = isOk && ((size & (size - 1)) == 0) && shm->map( fds[0], size);
+    ::close( fds[0]);  // The mapping stays
+    if (!isOk || (shm->_ctrl->magic != SHM_MAGIC) || (shm->_ctrl->version != SHM_VERSION)
+    ||  (shm->_ctrl->ringSize != size)) {
+        delete shm;
+        return arnNullptr;
+    }
+    return shm;
+#else
+    Q_UNUSED(socketFd)
+    return arnNullptr;
+#endif
+}
+
+
+bool  ArnSyncShm::sendSetup( int socketFd)
+{
+#ifdef Q_OS_LINUX
+    int  fds[ SHM_SETUPFDS] = {_memFd, _wakeFd[0], _wakeFd[1]};
+    char  byte = 'S';
+    char  cbuf[ CMSG_SPACE( sizeof fds)];
+    memset( cbuf, 0, sizeof cbuf);
+    struct iovec  iov;
+    iov.iov_base = &byte;
+    iov.iov_len  = 1;
+    struct msghdr  msg;
+    memset( &msg, 0, sizeof msg);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof cbuf;
+    struct cmsghdr*  cmsg = CMSG_FIRSTHDR( &msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN( sizeof fds);
+    memcpy( CMSG_DATA( cmsg), fds, sizeof fds);
+    ssize_t  r;
+    do {
+        r = ::sendmsg( socketFd, &msg, MSG_NOSIGNAL);
+    } while ((r < 0) && (errno == EINTR));
+
+    ::close( _memFd);  // The mapping stays
+    _memFd = -1;
+    return r == 1;
+#else
+    Q_UNUSED(socketFd)
+    return false;
+#endif
+}
+
+
+bool  ArnSyncShm::map( int memFd, int ringSize)
+{
+#ifdef Q_OS_LINUX
+    int  mapSize = SHM_CTRLSIZE + 2 * ringSize;
+    void*  base = ::mmap( arnNullptr, size_t( mapSize), PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (base == MAP_FAILED)  return false;
+
+    _ctrl     = static_cast<ArnSyncShmCtrl*>( base);
+    _mapSize  = mapSize;
+    _ringSize = ringSize;
+    char*  data = static_cast<char*>( base) + SHM_CTRLSIZE;
+    _txData = data + _side * ringSize;
+    _rxData = data + (1 - _side) * ringSize;
+    return true;
+#else
+    Q_UNUSED(memFd)
+    Q_UNUSED(ringSize)
+    return false;
+#endif
+}
+
+
+/// Must be called in the thread using the transport
+void  ArnSyncShm::start()
+{
+    if (_notifier)  return;
+
+    _notifier = new QSocketNotifier( _wakeFd[ _side], QSocketNotifier::Read, this);
+    connect( _notifier, SIGNAL(activated(int)), this, SLOT(doWake()));
+    QMetaObject::invokeMethod( this, "doWake", Qt::QueuedConnection);  // Data might already be there
+}
+
+
+int  ArnSyncShm::bytesAvailable()  const
+{
+    if (_isBroken)  return 0;
+
+    const ArnSyncShmRing&  ring = _ctrl->ring[ 1 - _side];
+    return qBound( 0, ringUsed( quint32( ring.head.loadAcquire()), quint32( ring.tail.loadAcquire())),
+                   _ringSize);
+}
+
+
+/// Positions are in memory the peer can write, a bad peer must not make us pass the ring
+int  ArnSyncShm::ringUsed( quint32 head, quint32 tail)  const
+{
+    quint32  used = head - tail;
+    if (used > quint32( _ringSize)) {
+        if (!_isBroken) {
+            _isBroken = true;
+            QMetaObject::invokeMethod( const_cast<ArnSyncShm*>( this), "broken", Qt::QueuedConnection);
+        }
+        return -1;
+    }
+    return int( used);
+}
+
+
+/// Returns -1 when the ring positions are out of range
+int  ArnSyncShm::read( char* data, int maxSize)
+{
+    if (_isBroken)  return -1;
+
+    ArnSyncShmRing&  ring = _ctrl->ring[ 1 - _side];
+    quint32  tail = quint32( ring.tail.loadAcquire());
+    int  used = ringUsed( quint32( ring.head.loadAcquire()), tail);
+    if (used < 0)  return -1;
+
+    int  n = qMin( maxSize, used);
+    if (n <= 0)  return 0;
+
+    int  pos   = int( tail & quint32( _ringSize - 1));
+    int  first = qMin( n, _ringSize - pos);
+    memcpy( data, _rxData + pos, size_t( first));
+    memcpy( data + first, _rxData, size_t( n - first));
+    ring.tail.fetchAndStoreOrdered( int( tail + quint32( n)));  // Ordered before reading peer wait flag
+    wakePeer( _ctrl->isWaitingSpace[ 1 - _side]);
+    return n;
+}
+
+
+/// Data not fitting in the ring is sent when the peer has read, bytesWritten() when all is in the ring
+void  ArnSyncShm::write( const QByteArray& data)
+{
+    if (_isBroken)  return;
+
+    if (_txPending.isEmpty()) {
+        int  n = ringWrite( data.constData(), data.size());
+        _writtenCount += n;
+        if (n < data.size())
+            _txPending = data.mid( n);
+    }
+    else {
+        _txPending += data;
+    }
+    flushTx();
+}
+
+
+int  ArnSyncShm::ringWrite( const char* data, int size)
+{
+    ArnSyncShmRing&  ring = _ctrl->ring[ _side];
+    quint32  head = quint32( ring.head.loadAcquire());
+    int  used = ringUsed( head, quint32( ring.tail.loadAcquire()));
+    if (used < 0)  return 0;
+
+    int  n = qMin( size, _ringSize - used);
+    if (n <= 0)  return 0;
+
+    int  pos   = int( head & quint32( _ringSize - 1));
+    int  first = qMin( n, _ringSize - pos);
+    memcpy( _txData + pos, data, size_t( first));
+    memcpy( _txData, data + first, size_t( n - first));
+    ring.head.fetchAndStoreOrdered( int( head + quint32( n)));  // Ordered before reading peer wait flag
+    wakePeer( _ctrl->isWaitingData[ 1 - _side]);
+    return n;
+}
+
+
+void  ArnSyncShm::flushTx()
+{
+    if (!_txPending.isEmpty()) {
+        _ctrl->isWaitingSpace[ _side].fetchAndStoreOrdered(1);  // Space freed after this wakes us
+        int  n = ringWrite( _txPending.constData(), _txPending.size());
+        _writtenCount += n;
+        _txPending.remove( 0, n);
+        if (!_txPending.isEmpty())  return;  // Rest when woken
+    }
+
+    if ((_writtenCount > 0) && !_isWrittenPosted) {
+        _isWrittenPosted = true;
+        QMetaObject::invokeMethod( this, "doEmitWritten", Qt::QueuedConnection);  // Like a socket
+    }
+}
+
+
+void  ArnSyncShm::doEmitWritten()
+{
+    _isWrittenPosted = false;
+    qint64  n = _writtenCount;
+    _writtenCount = 0;
+    if (n > 0)
+        emit bytesWritten( n);
+}
+
+
+/// The peer is only woken by a syscall when it has told it is sleeping
+void  ArnSyncShm::wakePeer( QAtomicInt& isPeerWaiting)
+{
+    if (!isPeerWaiting.fetchAndStoreOrdered(0))  return;  // Peer is busy, it checks the rings later
+
+#ifdef Q_OS_LINUX
+    quint64  one = 1;
+    if (::write( _wakeFd[ 1 - _side], &one, sizeof one) < 0) {
+        // Counter overflow is not possible, peer has read it before setting its wait flag again
+    }
+#endif
+}
+
+
+void  ArnSyncShm::doWake()
+{
+#ifdef Q_OS_LINUX
+    quint64  count;
+    if (::read( _wakeFd[ _side], &count, sizeof count) < 0) {
+        // Not woken by the eventfd, e.g. at start
+    }
+#endif
+    service();
+}
+
+
+void  ArnSyncShm::service()
+{
+    if (_isBroken)  return;
+
+    _ctrl->isWaitingData[ _side].fetchAndStoreOrdered(1);  // Data written after this wakes us
+    flushTx();
+    if (bytesAvailable() > 0)
+        emit readyRead();
+}
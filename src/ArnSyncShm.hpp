@@ -0,0 +1,107 @@
+// Copyright (C) 2010-2022 Michael Wiklund.
+// All rights reserved.
+// Contact: arnlib@wiklunden.se
+//
+// This file is part of the ArnLib - Active Registry Network.
+// Parts of ArnLib depend on Qt and/or other libraries that have their own
+// licenses. Usage of these other libraries is subject to their respective
+// license agreements.
+//
+// GNU Lesser General Public License Usage
+// This file may be used under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation and
+// appearing in the file LICENSE_LGPL.txt included in the packaging of this
+// file. In addition, as a special exception, you may use the rights described
+// in the Nokia Qt LGPL Exception version 1.1, included in the file
+// LGPL_EXCEPTION.txt in this package.
+//
+// GNU General Public License Usage
+// Alternatively, this file may be used under the terms of the GNU General Public
+// License version 3.0 as published by the Free Software Foundation and appearing
+// in the file LICENSE_GPL.txt included in the packaging of this file.
+//
+// Other Usage
+// Alternatively, this file may be used in accordance with the terms and conditions
+// contained in a signed written agreement between you and Michael Wiklund.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+// PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+//
+
+#ifndef ARNSYNCSHM_HPP
+#define ARNSYNCSHM_HPP
+
+#include "ArnInc/ArnLib_global.hpp"
+#include <QObject>
+#include <QByteArray>
+
+class QSocketNotifier;
+class QAtomicInt;
+struct ArnSyncShmCtrl;
+
+
+//! \cond ADV
+//! Shared memory transport of an ArnSync connection between two processes on one host
+/*! Records are passed in a pair of single producer single consumer byte rings. A side
+ *  sleeping in its event loop is woken by an eventfd, the peer only writes to it when the
+ *  side has told it is waiting. Setup is done over the Unix domain socket of the connection,
+ *  it is then only used for detecting a closed connection.
+ *  Only available on Linux.
+ */
+class ArnSyncShm : public QObject
+{
+    Q_OBJECT
+public:
+    ~ArnSyncShm();
+
+    static bool  isSupported();
+    //! Client side, makes the shared memory and the wakeup eventfds
+    static ArnSyncShm*  create( int ringSize);
+    //! Server side, shared memory and eventfds are received from the client
+    static ArnSyncShm*  receiveSetup( int socketFd);
+    //! Client side, passes the shared memory and eventfds to the server
+    bool  sendSetup( int socketFd);
+
+    void  start();
+    int  bytesAvailable()  const;
+    int  read( char* data, int maxSize);
+    void  write( const QByteArray& data);
+
+signals:
+    void  readyRead();
+    void  bytesWritten( qint64 bytes);
+    //! Ring positions out of range, the peer is not trusted any more
+    void  broken();
+
+private slots:
+    void  doWake();
+    void  doEmitWritten();
+
+private:
+    ArnSyncShm( int side);
+
+    bool  map( int memFd, int ringSize);
+    void  service();
+    void  flushTx();
+    int  ringWrite( const char* data, int size);
+    int  ringUsed( quint32 head, quint32 tail)  const;
+    void  wakePeer( QAtomicInt& isPeerWaiting);
+
+    ArnSyncShmCtrl*  _ctrl;
+    char*  _rxData;
+    char*  _txData;
+    int  _mapSize;
+    int  _ringSize;
+    int  _side;          // 0 = client, 1 = server
+    int  _memFd;         // Until sent to the server
+    int  _wakeFd[2];     // Wakes the side with same index
+    QSocketNotifier*  _notifier;
+    QByteArray  _txPending;  // Not fitting in the ring
+    qint64  _writtenCount;   // Bytes in ring not yet reported by bytesWritten
+    bool  _isWrittenPosted;
+    mutable bool  _isBroken;
+};
+//! \endcond
+
+#endif // ARNSYNCSHM_HPP
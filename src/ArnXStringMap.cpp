@@ -742,43 +742,58 @@ bool  XStringMap::fromXString( const QByteArray& inXString, int size)
     if ((size < 0) || (size > inXString.size())) {
         size = inXString.size();
     }
+    return fromXString( inXString.constData(), size);
+}
+
+
+static inline int  xsIndexOf( const char* data, int size, char c, int from)
+{
+    if (from >= size)  return -1;
+    const void*  p = memchr( data + from, c, size_t( size - from));
+    return p ? int( static_cast<const char*>( p) - data) : -1;
+}
+
+
+/// Parsed in place, data is only read within size (need not be terminated)
+bool  XStringMap::fromXString( const char* inXString, int size)
+{
     clear();
-    if (size == 0)  return true;  // Nothing to load
+    if (!inXString || (size <= 0))  return true;  // Nothing to load
 
     int  startPos = 0;
     QByteArray  key;
     QByteArray  val;
-    QByteArray  txtCoded;
 
     forever {
         bool isFrame = false;
         if (startPos >= size) {     // if past end of line, finished
             break;
         }
-        while ( inXString.at( startPos) == ' ') {   // Skip leading space before key (only possible by manual coding)
+        while ((startPos < size) && (inXString[ startPos] == ' ')) {   // Skip leading space before key (only possible by manual coding)
             ++startPos;
         }
 
         // Start getting key
         key.resize(0);  // Default empty key
-        int  posEq  = inXString.indexOf( '=', startPos);
-        int  posSep = inXString.indexOf( ' ', startPos);
-        if (posSep < 0  ||  posSep >= size) {
+        int  posEq  = xsIndexOf( inXString, size, '=', startPos);
+        int  posSep = xsIndexOf( inXString, size, ' ', startPos);
+        if (posSep < 0) {
             posSep = size; // last separator pos is set to end of string
         }
         if ((posEq >= 0) && (posEq < posSep)) {  // Key found
             int  keyOrgStart = startPos;
             int  keyOrgLen   = 0;
-            if ((posEq > startPos) && (inXString.at( posEq - 1) == '|')) {  // Framed value
+            if ((posEq > startPos) && (inXString[ posEq - 1] == '|')) {  // Framed value
                 isFrame = true;
-                int  posFrSt     = inXString.indexOf( '<', posEq + 1);
+                int  posFrSt     = xsIndexOf( inXString, size, '<', posEq + 1);
                 int  frameLen    = -1;
                 bool  frameLenOk = false;
                 if ((posFrSt > posEq) && (posFrSt < size - 1)) {
-                    frameLen = inXString.mid( posEq + 1, posFrSt - posEq - 1).toInt( &frameLenOk);
+                    frameLen = QByteArray::fromRawData( inXString + posEq + 1, posFrSt - posEq - 1)
+                               .toInt( &frameLenOk);
                 }
                 int  posFrEn = posFrSt + frameLen + 1;
-                if (frameLenOk && (posFrEn < size) && (inXString.at( posFrEn) == '>')) {
+                if (frameLenOk && (frameLen >= 0) && (posFrEn < size) && (inXString[ posFrEn] == '>')) {
                     keyOrgLen = posEq - startPos - 1;
                     startPos  = posFrSt + 1;  // past '<'
                     posSep    = posFrEn + 1;  // past '>'
@@ -789,25 +804,21 @@ bool  XStringMap::fromXString( const QByteArray& inXString, int size)
                 keyOrgLen = posEq - startPos;
                 startPos  = posEq + 1;     // past '='
             }
-            if ((keyOrgLen >= 2) && (inXString.at( keyOrgStart) == '^') && (inXString.at( keyOrgStart + 1) == ':')) {  // Coded key
-                txtCoded.resize(0);
-                txtCoded.append( inXString.constData() + keyOrgStart + 2, keyOrgLen - 2);
-                stringDecode( key, txtCoded);
+            if ((keyOrgLen >= 2) && (inXString[ keyOrgStart] == '^') && (inXString[ keyOrgStart + 1] == ':')) {  // Coded key
+                stringDecode( key, inXString + keyOrgStart + 2, keyOrgLen - 2);
             }
             else {
-                key.append( inXString.constData() + keyOrgStart, keyOrgLen);
+                key.append( inXString + keyOrgStart, keyOrgLen);
             }
         }
 
         // Start getting value
         if (isFrame) {
             val.resize(0);
-            val.append( inXString.constData() + startPos, posSep - startPos - 1);
+            val.append( inXString + startPos, posSep - startPos - 1);
         }
         else {
-            txtCoded.resize(0);
-            txtCoded.append( inXString.constData() + startPos, posSep - startPos);
-            stringDecode( val, txtCoded);
+            stringDecode( val, inXString + startPos, posSep - startPos);
         }
         startPos = posSep + 1;     // past separator ' '
 
@@ -823,6 +834,158 @@ bool XStringMap::fromXString( const QString& inXString)
 }
 
 
+/// Binary field tag: bit 0 is key present, upper nibble is value type
+#define XSMBIN_KEY       0x01
+#define XSMBIN_VALEMPTY  0x00
+#define XSMBIN_VALRAW    0x10
+#define XSMBIN_VALUINT   0x20
+#define XSMBIN_VALMASK   0xf0
+
+static inline void  binAddVarUInt( QByteArray& dst, quint32 val)
+{
+    while (val >= 0x80) {
+        dst += char( (val & 0x7f) | 0x80);
+        val >>= 7;
+    }
+    dst += char( val);
+}
+
+
+static inline bool  binGetVarUInt( const uchar*& p, const uchar* end, quint32& val)
+{
+    val = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end)  return false;
+        uchar  c = *p++;
+        val |= quint32( c & 0x7f) << shift;
+        if (!(c & 0x80))  return true;
+    }
+    return false;  // Too long
+}
+
+
+/// Only decimal numbers exactly as given by QByteArray::number() are sent as UInt
+static inline bool  binIsUIntValue( const QByteArray& val, quint32& num)
+{
+    int  len = val.size();
+    if ((len == 0) || (len > 9))  return false;  // 9 digits always fit in 32 bits
+    const char*  p = val.constData();
+    if ((p[0] == '0') && (len > 1))  return false;  // Leading zero would be lost
+
+    quint32  n = 0;
+    for (int i = 0; i < len; ++i) {
+        char  c = p[i];
+        if ((c < '0') || (c > '9'))  return false;
+        n = n * 10 + quint32( c - '0');
+    }
+    num = n;
+    return true;
+}
+
+
+QByteArray  XStringMap::toBinary()  const
+{
+    return toBinaryMain( arnNullptr);
+}
+
+
+/// Avoids copying the map to replace the first value, e.g. a command name by its code
+QByteArray  XStringMap::toBinary( quint32 firstValNum)  const
+{
+    return toBinaryMain( &firstValNum);
+}
+
+
+QByteArray  XStringMap::toBinaryMain( const quint32* firstValNum)  const
+{
+    int  sizeHint = 0;
+    for (int i = 0; i < _size; ++i) {
+        sizeHint += _keyList.at(i).size() + _valList.at(i).size() + 6;
+    }
+    QByteArray  outBin;
+    outBin.reserve( sizeHint);
+
+    for (int i = 0; i < _size; ++i) {
+        const QByteArray&  key = _keyList.at(i);
+        const QByteArray&  val = _valList.at(i);
+        quint32  num = 0;
+        uchar  tag = key.isEmpty() ? 0 : XSMBIN_KEY;
+        if ((i == 0) && firstValNum) {
+            num  = *firstValNum;
+            tag |= XSMBIN_VALUINT;
+        }
+        else if (val.isEmpty())
+            tag |= XSMBIN_VALEMPTY;
+        else if (binIsUIntValue( val, num))
+            tag |= XSMBIN_VALUINT;
+        else
+            tag |= XSMBIN_VALRAW;
+
+        outBin += char( tag);
+        if (!key.isEmpty()) {
+            binAddVarUInt( outBin, quint32( key.size()));
+            outBin += key;
+        }
+        switch (tag & XSMBIN_VALMASK) {
+        case XSMBIN_VALUINT:
+            binAddVarUInt( outBin, num);
+            break;
+        case XSMBIN_VALRAW:
+            binAddVarUInt( outBin, quint32( val.size()));
+            outBin += val;  // Raw value, no coding
+            break;
+        default:
+            break;
+        }
+    }
+    return outBin;
+}
+
+
+bool  XStringMap::fromBinary( const char* data, int size)
+{
+    clear();
+    if (!data || (size <= 0))  return true;  // Nothing to load
+
+    const uchar*  p   = reinterpret_cast<const uchar*>( data);
+    const uchar*  end = p + size;
+    QByteArray  key;
+    QByteArray  val;
+    quint32  num;
+
+    while (p < end) {
+        uchar  tag = *p++;
+
+        key.resize(0);
+        if (tag & XSMBIN_KEY) {
+            if (!binGetVarUInt( p, end, num) || (num > quint32( end - p)))  return false;
+            key.append( reinterpret_cast<const char*>( p), int( num));
+            p += num;
+        }
+
+        val.resize(0);
+        switch (tag & XSMBIN_VALMASK) {
+        case XSMBIN_VALEMPTY:
+            break;
+        case XSMBIN_VALUINT:
+            if (!binGetVarUInt( p, end, num))  return false;
+            val.setNum( num);
+            break;
+        case XSMBIN_VALRAW:
+            if (!binGetVarUInt( p, end, num) || (num > quint32( end - p)))  return false;
+            val.append( reinterpret_cast<const char*>( p), int( num));
+            p += num;
+            break;
+        default:
+            return false;  // Unknown value type
+        }
+
+        add( key, val);
+    }
+    return true;
+}
+
+
 void  XStringMap::stringCode( QByteArray& dst, const QByteArray& src)  const
 {
     bool  optRepeatLen = _options.is( Options::RepeatLen);
@@ -969,8 +1132,13 @@ void  XStringMap::stringCode( QByteArray& dst, const QByteArray& src)  const
 
 void  XStringMap::stringDecode( QByteArray& dst, const QByteArray& src)  const
 {
-    int  srcSize = src.size();
-    const char*  srcP = src.constData();
+    stringDecode( dst, src.constData(), src.size());
+}
+
+
+void  XStringMap::stringDecode( QByteArray& dst, const char* src, int srcSize)  const
+{
+    const char*  srcP = src;
 
     dst.resize( srcSize * 5);   // Max size of decoded string. Worst for repeated chars like "A\9\9"
     char*  dstStart = dst.data();
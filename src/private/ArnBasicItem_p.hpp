@@ -45,6 +45,7 @@ class ArnEvent;
 class ArnBasicItemPrivate
 {
     friend class ArnBasicItem;
+    friend class ArnBasicItemEventHandler;
 public:
     ArnBasicItemPrivate();
     virtual ~ArnBasicItemPrivate();
@@ -64,6 +65,9 @@ private:
     void*  _reference;
     QObject*  _eventHandler;
     ArnEvent*  _pendingEvChain;
+    QAtomicInt  _conflatePending;  // Batched value changes not yet delivered
+    QAtomicInt  _isConflate;       // Read by producer threads when batching
+    quint32  _conflateDropCount;
 #ifdef ARNITEMB_INCPATH
     QString _path;
 #endif
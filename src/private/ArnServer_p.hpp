@@ -34,6 +34,12 @@
 
 #include "ArnInc/ArnServer.hpp"
 #include <QTcpServer>
+#include <QLocalServer>
+#include <QList>
+#include <QQueue>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 0, 0)
   #define ARNSOCKD  qintptr
@@ -41,6 +47,40 @@
   #define ARNSOCKD  int
 #endif
 
+class ArnSyncShm;
+class QTimer;
+
+
+/// Sessions in one I/O thread of an ArnServer, this object lives in the thread
+class ArnServerIoThread : public QObject
+{
+    Q_OBJECT
+public:
+    ArnServerIoThread( ArnServer* arnServer, int index);
+    ~ArnServerIoThread();
+
+    void  start();
+    void  stop();
+    int  sessionCount()  const;
+    void  addConnection( qint64 socketDescriptor, ArnSyncShm* shm = arnNullptr);
+
+private slots:
+    void  onStarted();
+    void  onFinished();
+    void  doAddConnection( qint64 socketDescriptor, QObject* shmObj);
+    void  onSessionEnd();
+    void  doStat();
+
+private:
+    QThread  _thread;
+    ArnServer*  _arnServer;
+    QTimer*  _statTimer;
+    QElapsedTimer  _statClock;
+    QAtomicInt  _sessionCount;
+    quint64  _lastTraffic;
+    QString  _statPath;
+};
+
 
 class ArnSslServer : public QTcpServer
 {
@@ -48,8 +88,37 @@ public:
     ArnSslServer();
     ~ArnSslServer();
 
+    void  setIoThreads( const QList<ArnServerIoThread*>& ioThreads);
     virtual void  incomingConnection( ARNSOCKD socketDescriptor);
     QSslSocket*  nextPendingSslConnection();
+
+private:
+    QList<ArnServerIoThread*>  _ioThreads;  // Empty when sessions are in the server thread
+};
+
+
+class ArnLocalServer : public QLocalServer
+{
+    Q_OBJECT
+public:
+    explicit ArnLocalServer( bool isShm = false);
+    ~ArnLocalServer();
+
+    void  setIoThreads( const QList<ArnServerIoThread*>& ioThreads);
+    QSslSocket*  nextPendingSslConnection();
+
+protected:
+    virtual void  incomingConnection( quintptr socketDescriptor);
+
+private slots:
+    void  doShmSetup();
+
+private:
+    void  addConnection( quintptr socketDescriptor, ArnSyncShm* shm);
+
+    QList<ArnServerIoThread*>  _ioThreads;  // Empty when sessions are in the server thread
+    QQueue<QSslSocket*>  _pendingSockets;
+    bool  _isShm;  // Clients pass shared memory for the records before the session starts
 };
 
 
@@ -62,8 +131,12 @@ public:
 
 private:
     ArnSslServer*  _sslServer;
+    ArnLocalServer*  _localServer;
+    ArnLocalServer*  _shmServer;
     ArnSyncLogin*  _arnLogin;
     ArnServerSession*  _newSession;
+    QList<ArnServerIoThread*>  _ioThreads;
+    int  _ioThreadNum;
     QStringList  _freePathTab;
     QStringList  _noLoginNets;
     QByteArray  _whoIAm;
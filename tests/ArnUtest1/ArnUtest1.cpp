@@ -3,7 +3,11 @@
 #include <ArnInc/ArnBasicItem.hpp>
 #include <ArnInc/ArnItem.hpp>
 #include <ArnItemNet.hpp>
+#include <ArnSync.hpp>
 #include <ArnInc/ArnMonitor.hpp>
+#include <ArnInc/ArnServer.hpp>
+#include <ArnInc/ArnClient.hpp>
+#include <ArnInc/ArnPipe.hpp>
 #include <ArnInc/MQFlags.hpp>
 #include <ArnInc/Math.hpp>
 #include <ArnInc/XStringMap.hpp>
@@ -13,6 +17,7 @@
 #include <QString>
 #include <QtTest>
 #include <QDebug>
+#include <algorithm>
 
 
 class ArnUtest1Sub : public QObject
@@ -30,6 +35,171 @@ public slots:
 };
 
 
+class ArnUtest1Thread : public QThread
+{
+public:
+    ArnUtest1Thread( const QString& path, int readNum = 1)
+        : _path( path), _readNum( readNum), _isOpen( false), _value( 0) {}
+
+    QString  _path;
+    int  _readNum;
+    bool  _isOpen;
+    int  _value;
+
+protected:
+    void  run()
+    {
+        ArnBasicItem  item;
+        _isOpen = item.open( _path);
+        for (int i = 0; i < _readNum; ++i) {
+            _value = item.toInt();
+        }
+    }
+};
+
+
+class ArnUtest1EvCounter : public QObject
+{
+public:
+    ArnUtest1EvCounter( QAtomicInt* count, QAtomicInt* dropCount, QAtomicInt* value)
+        : _count( count), _dropCount( dropCount), _value( value) {}
+
+protected:
+    void  customEvent( QEvent* ev)
+    {
+        if (ev->type() == ArnEvValueChange::type()) {
+            ArnBasicItem*  item = static_cast<ArnBasicItem*>( static_cast<ArnEvent*>( ev)->target());
+            _count->ref();
+            _dropCount->fetchAndStoreOrdered( int( item->conflateDropCount()));
+            _value->fetchAndStoreOrdered( item->toInt());
+        }
+        ArnBasicItemEventHandler::defaultEvent( ev);
+    }
+
+    QAtomicInt*  _count;
+    QAtomicInt*  _dropCount;
+    QAtomicInt*  _value;
+};
+
+
+class ArnUtest1EvPeek : public QObject
+{
+public:
+    explicit ArnUtest1EvPeek( const QString& peekPath)
+        : _peekPath( peekPath), _count( 0), _peekValue( 0) {}
+
+    QString  _peekPath;
+    int  _count;
+    int  _peekValue;  // Value at peekPath when event was received
+
+protected:
+    void  customEvent( QEvent* ev)
+    {
+        if (ev->type() == ArnEvValueChange::type()) {
+            ++_count;
+            _peekValue = ArnM::valueInt( _peekPath);
+        }
+        ArnBasicItemEventHandler::defaultEvent( ev);
+    }
+};
+
+
+class ArnUtest1EvThread : public QThread
+{
+public:
+    ArnUtest1EvThread( const QString& path, int itemNum, bool isConflate = false)
+        : _path( path), _itemNum( itemNum), _isConflate( isConflate)
+        , _evCount( 0), _dropCount( 0), _value( 0), _isReady( 0) {}
+
+    QString  _path;
+    int  _itemNum;
+    bool  _isConflate;
+    QAtomicInt  _evCount;
+    QAtomicInt  _dropCount;
+    QAtomicInt  _value;
+    QAtomicInt  _isReady;
+    QSemaphore  _goSem;  // Event loop starts when released
+
+protected:
+    void  run()
+    {
+        ArnUtest1EvCounter  counter( &_evCount, &_dropCount, &_value);
+        QList<ArnBasicItem*>  items;
+        for (int i = 0; i < _itemNum; ++i) {
+            ArnBasicItem*  item = new ArnBasicItem;
+            item->setEventHandler( &counter);
+            item->setConflate( _isConflate);
+            item->open( _path);
+            items += item;
+        }
+        _isReady.storeRelease( 1);
+        _goSem.acquire();
+        exec();
+        qDeleteAll( items);
+    }
+};
+
+
+//// Busy wait in the event loop, the 50 ms poll of QTRY_ would swamp a benchmark
+#define UTEST_WAIT( expr) \
+    do { \
+        QElapsedTimer  utestDeadline; \
+        utestDeadline.start(); \
+        while (!(expr) && (utestDeadline.elapsed() < 30000)) { \
+            QCoreApplication::processEvents(); \
+        } \
+    } while (0)
+
+
+//// Same host ArnServer on a dynamic port, clients mount a client path to a server path
+class ArnUtest1Sync
+{
+public:
+    explicit ArnUtest1Sync( int ioThreadNum = 0)
+        : _server( ArnServer::Type::NetSync)
+    {
+        _server.setIoThreadNum( ioThreadNum);
+        _server.start( 0, QHostAddress::LocalHost);
+    }
+
+    ~ArnUtest1Sync()
+    {
+        foreach (ArnClient* client, _clientList) {
+            client->close();
+        }
+        qDeleteAll( _clientList);
+    }
+
+    ArnClient*  addClient( const QString& cliPath, const QString& srvPath,
+                           const QString& host = "localhost", bool isCompress = false)
+    {
+        ArnClient*  client = new ArnClient;
+        client->setCompress( isCompress);
+        client->addMountPoint( cliPath, srvPath);
+        client->connectToArn( host, _server.port());
+        _clientList += client;
+        return client;
+    }
+
+    bool  waitConnected()
+    {
+        for (int t = 0; t < 500; ++t) {
+            bool  isAllConnected = true;
+            foreach (ArnClient* client, _clientList) {
+                isAllConnected = isAllConnected
+                              && (client->connectStatus() == ArnClient::ConnectStat::Connected);
+            }
+            if (isAllConnected)  return true;
+            QTest::qWait(10);
+        }
+        return false;
+    }
+
+    ArnServer  _server;
+    QList<ArnClient*>  _clientList;
+};
+
+
 class ArnUtest1 : public QObject
 {
     Q_OBJECT
@@ -47,10 +217,37 @@ private slots:
     void  testArnBasicItem1();
     void  testArnBasicItem2();
     void  testArnBasicItemDestroy();
+    void  measureArnLinkWideFolder();
+    void  measureArnLinkPathCache();
+    void  testArnLinkThreadFind();
+    void  testArnLinkValueCache();
+    void  measureArnLinkThreadedRead_data();
+    void  measureArnLinkThreadedRead();
+    void  measureArnLinkBatchEvent();
+    void  testArnItemConflate();
+    void  testArnMTransaction();
+    void  testArnMSnapshot();
+    void  measureArnMDestroyTree();
     void  testArnItem1();
     void  testArnItem2();
     void  testArnItemDestroy();
     void  testArnItemNet1();
+    void  testArnItemNetTab();
+    void  measureArnSyncBinFrame_data();
+    void  measureArnSyncBinFrame();
+    void  measureArnSyncCompress();
+    void  measureArnSyncResume();
+    void  measureArnSyncBulk();
+    void  measureArnSyncFanOut();
+    void  measureArnSyncPipeOverwrite();
+    void  measureArnSyncPrio();
+    void  testArnServerIoThreads();
+    void  testArnSyncTreeDestroy();
+    void  measureArnSyncLocalLatency_data();
+    void  measureArnSyncLocalLatency();
+    void  measureArnSyncLocalThroughput_data();
+    void  measureArnSyncLocalThroughput();
+    void  measureArnSyncFluxIngest();
     void  testArnMonitorLocal();
     void  testArnQml1();
 
@@ -367,6 +564,29 @@ void  ArnUtest1::testXStringMap()
     xsm7.fromXString( b6Xstr);
     b7Val = xsm7.value( b6Key);
     QVERIFY( b7Val == b6Val);
+
+    XStringMap xsm8;
+    xsm8.add("", "flux").add("id", "123").add("seq", "007").add("data", QByteArray("a\0b\r\n c", 7));
+    xsm8.add("empty", "");
+    QByteArray b8Bin = xsm8.toBinary();
+    XStringMap xsm9;
+    QVERIFY( xsm9.fromBinary( b8Bin.constData(), b8Bin.size()));
+    QVERIFY( xsm9.toXString() == xsm8.toXString());
+    QVERIFY( xsm9.value("data") == QByteArray("a\0b\r\n c", 7));
+    QVERIFY( xsm9.value("seq") == "007");
+    QVERIFY( xsm9.fromBinary( b8Bin.constData(), b8Bin.size() - 1) == false);
+    QByteArray b8Code = xsm8.toBinary( 12);  // First value as code, map is not changed
+    QVERIFY( xsm8.valueRef(0) == "flux");
+    QVERIFY( xsm9.fromBinary( b8Code.constData(), b8Code.size()));
+    QVERIFY( xsm9.valueRef(0) == "12");
+    QVERIFY( xsm9.value("data") == QByteArray("a\0b\r\n c", 7));
+
+    QByteArray b9Recs = "flux id=12 data=a_b\r\nflux id=13 data|=3<c d>\r\n";
+    int b9Eol = b9Recs.indexOf('\n');
+    QVERIFY( xsm9.fromXString( b9Recs.constData(), b9Eol - 1));  // View of first record, no copy
+    QVERIFY( xsm9.toXString() == "flux id=12 data=a_b");
+    QVERIFY( xsm9.fromXString( b9Recs.constData() + b9Eol + 1, b9Recs.size() - b9Eol - 3));
+    QVERIFY( xsm9.value("data") == "c d");
 }
 
 
@@ -465,6 +685,283 @@ void ArnUtest1::testArnBasicItemDestroy()
 }
 
 
+void ArnUtest1::measureArnLinkWideFolder()
+{
+    const int  siblingNum = 100000;
+    for (int i = 0; i < siblingNum; ++i) {
+        ArnM::setValue("//Test/Wide/s" + QString::number(i), i);
+    }
+    QCOMPARE( ArnM::items("//Test/Wide/").size(), siblingNum);
+    QCOMPARE( ArnM::valueInt("//Test/Wide/s0"), 0);
+    QCOMPARE( ArnM::valueInt("//Test/Wide/s77777"), 77777);
+    QVERIFY( ArnM::exist("//Test/Wide/s" + QString::number( siblingNum)) == false);
+
+    ArnBasicItem  arnT1;
+    QBENCHMARK {
+        arnT1.open("//Test/Wide/s99999");
+    }
+    QCOMPARE( arnT1.toInt(), 99999);
+}
+
+
+void ArnUtest1::measureArnLinkPathCache()
+{
+    QString  path = "//Test/Deep/a/b/c/d/e/f/g/value";
+    ArnM::setValue( path, 1);
+    ArnBasicItem  arnT1;
+    QBENCHMARK {
+        arnT1.open( path);
+    }
+    QCOMPARE( arnT1.toInt(), 1);
+    arnT1.close();
+
+    //// Cached path must not hide a type mismatch or a destroyed link
+    QVERIFY( ArnM::exist("//Test/Deep/a/b/c/d/e/f/g/value/") == false);
+    ArnM::destroyLink("//Test/Deep/");
+    QVERIFY( ArnM::exist( path) == false);
+    QVERIFY( ArnM::exist("//Test/Deep/a/") == false);
+}
+
+
+void ArnUtest1::testArnLinkThreadFind()
+{
+    QString  path = "//Test/Tth1/value";
+    ArnM::setValue( path, 7);
+
+    //// First open from thread is done by main-thread, the link becomes threaded
+    ArnUtest1Thread  thread1( path);
+    QEventLoop  loop;
+    connect( &thread1, SIGNAL(finished()), &loop, SLOT(quit()));
+    thread1.start();
+    loop.exec();
+    QCOMPARE( thread1._isOpen, true);
+    QCOMPARE( thread1._value, 7);
+
+    //// Existing threaded link in use must open without main-thread event loop running
+    ArnBasicItem  holder;
+    QVERIFY( holder.open( path));
+    ArnUtest1Thread  thread2( path);
+    thread2.start();
+    QVERIFY( thread2.wait( 5000));
+    QCOMPARE( thread2._isOpen, true);
+    QCOMPARE( thread2._value, 7);
+    holder.close();
+
+    //// Unreferenced link is left to main-thread, it might be about to be deleted
+    QTest::qWait(10);  // Handle zeroRef
+    ArnUtest1Thread  thread3( path);
+    connect( &thread3, SIGNAL(finished()), &loop, SLOT(quit()));
+    thread3.start();
+    loop.exec();
+    QCOMPARE( thread3._isOpen, true);
+    QCOMPARE( thread3._value, 7);
+}
+
+
+void ArnUtest1::testArnLinkValueCache()
+{
+    ArnM::setValue("//Test/Tvc1/int", 123);
+    ArnM::setValue("//Test/Tvc1/str", QString("4.5"));
+    QCOMPARE( ArnM::valueString("//Test/Tvc1/int"), QString("123"));
+    QCOMPARE( ArnM::valueByteArray("//Test/Tvc1/str"), QByteArray("4.5"));
+
+    ArnM::dropValueCaches("//Test/Tvc1/");
+    QCOMPARE( ArnM::valueInt("//Test/Tvc1/int"), 123);
+    QCOMPARE( ArnM::valueString("//Test/Tvc1/int"), QString("123"));
+    QCOMPARE( ArnM::valueString("//Test/Tvc1/str"), QString("4.5"));
+    QCOMPARE( ArnM::valueByteArray("//Test/Tvc1/str"), QByteArray("4.5"));
+    QCOMPARE( ArnM::valueReal("//Test/Tvc1/str"), ARNREAL(4.5));
+}
+
+
+void ArnUtest1::measureArnLinkThreadedRead_data()
+{
+    QTest::addColumn<bool>("offLockFreeRead");
+    QTest::newRow("lockFree") << false;
+    QTest::newRow("mutex")    << true;
+}
+
+
+void ArnUtest1::measureArnLinkThreadedRead()
+{
+    QFETCH( bool, offLockFreeRead);
+    QString  path = "//Test/Tth2/value";
+    ArnM::setValue( path, 5);
+    ArnBasicItem  holder;  // Link in use, workers open it without main-thread event loop running
+    QVERIFY( holder.open( path));
+
+    //// Make the link threaded
+    ArnUtest1Thread  thread0( path);
+    QEventLoop  loop;
+    connect( &thread0, SIGNAL(finished()), &loop, SLOT(quit()));
+    thread0.start();
+    loop.exec();
+    QCOMPARE( thread0._value, 5);
+
+    const int  threadNum = 8;
+    const int  readNum   = 1000000;
+    Arn::offLockFreeRead = offLockFreeRead;
+    QBENCHMARK {
+        QList<ArnUtest1Thread*>  threads;
+        for (int i = 0; i < threadNum; ++i) {
+            threads += new ArnUtest1Thread( path, readNum);
+        }
+        for (int i = 0; i < threadNum; ++i) {
+            threads.at(i)->start();
+        }
+        for (int i = 0; i < threadNum; ++i) {
+            QVERIFY( threads.at(i)->wait( 60000));
+            QCOMPARE( threads.at(i)->_value, 5);
+        }
+        qDeleteAll( threads);
+    }
+    Arn::offLockFreeRead = false;
+}
+
+
+void ArnUtest1::measureArnLinkBatchEvent()
+{
+    QString  path = "//Test/Tth3/value";
+    ArnM::setValue( path, 0);
+
+    const int  itemNum   = 20;
+    const int  updateNum = 10000;
+    ArnUtest1EvThread  thread( path, itemNum);
+    thread.start();
+    QTRY_COMPARE( thread._isReady.loadAcquire(), 1);
+    thread._goSem.release();
+
+    ArnBasicItem  arnT1;
+    arnT1.open( path);
+    int  updateCount = 0;
+    QBENCHMARK {
+        for (int i = 0; i < updateNum; ++i) {
+            arnT1 = ++updateCount;
+        }
+        UTEST_WAIT( thread._evCount.loadAcquire() == itemNum * updateCount);
+    }
+    QCOMPARE( thread._evCount.loadAcquire(), itemNum * updateCount);
+
+    thread.quit();
+    QVERIFY( thread.wait( 5000));
+}
+
+
+void ArnUtest1::testArnItemConflate()
+{
+    QString  path = "//Test/Tth4/value";
+    ArnM::setValue( path, 0);
+
+    const int  updateNum = 100;
+    ArnUtest1EvThread  thread( path, 1, true);
+    thread.start();
+    QTRY_COMPARE( thread._isReady.loadAcquire(), 1);
+
+    //// Consumer thread is not running its event loop, all updates are pending
+    ArnBasicItem  arnT1;
+    arnT1.open( path);
+    for (int i = 1; i <= updateNum; ++i) {
+        arnT1 = i;
+    }
+    thread._goSem.release();
+
+    QTRY_COMPARE( thread._evCount.loadAcquire(), 1);
+    QCOMPARE( thread._dropCount.loadAcquire(), updateNum - 1);
+    QCOMPARE( thread._value.loadAcquire(), updateNum);
+
+    thread.quit();
+    QVERIFY( thread.wait( 5000));
+}
+
+
+void ArnUtest1::testArnMTransaction()
+{
+    ArnM::setValue("//Test/Ttr1/a", 0);
+    ArnM::setValue("//Test/Ttr1/b", 0);
+
+    ArnUtest1EvPeek  peek("//Test/Ttr1/b");
+    ArnBasicItem  arnA;
+    arnA.setEventHandler( &peek);
+    arnA.open("//Test/Ttr1/a");
+
+    //// Path "a" is assigned before "b", but notified after all is assigned
+    QVariantMap  pathValues;
+    pathValues.insert("//Test/Ttr1/a", 1);
+    pathValues.insert("//Test/Ttr1/b", 2);
+    pathValues.insert("//Test/Ttr1/c", QString("txt"));
+    ArnM::setValues( pathValues);
+    QCOMPARE( peek._count, 1);
+    QCOMPARE( peek._peekValue, 2);
+    QCOMPARE( arnA.toInt(), 1);
+    QCOMPARE( ArnM::valueString("//Test/Ttr1/c"), QString("txt"));
+
+    ArnM::setValue("//Test/Ttr1/a", 3);
+    QCOMPARE( peek._count, 2);
+}
+
+
+void ArnUtest1::testArnMSnapshot()
+{
+    const int  leafNum = 100000;
+    for (int i = 0; i < leafNum; ++i) {
+        ArnM::setValue("//Test/Tsn1/big/s" + QString::number(i), i);
+    }
+    ArnM::setValue("//Test/Tsn1/sub/real", ARNREAL(2.5));
+    ArnM::setValue("//Test/Tsn1/sub/str", QString("text"));
+    ArnM::setValue("//Test/Tsn1/sub/bytes", QByteArray("a b\nc"));
+    ArnItem  arnSave("//Test/Tsn1/sub/save");
+    arnSave.setSaveMode();
+    arnSave = 7;
+
+    QString  fileName = QDir::tempPath() + "/ArnUtest1.snap";
+    QBENCHMARK {
+        QVERIFY( ArnM::saveSnapshot("//Test/Tsn1/", fileName));
+        QVERIFY( ArnM::loadSnapshot("//Test/Tsn2/", fileName));
+    }
+    QFile::remove( fileName);
+
+    QCOMPARE( ArnM::items("//Test/Tsn2/big/").size(), leafNum);
+    QCOMPARE( ArnM::valueInt("//Test/Tsn2/big/s77777"), 77777);
+    QCOMPARE( ArnM::valueReal("//Test/Tsn2/sub/real"), ARNREAL(2.5));
+    QCOMPARE( ArnM::valueString("//Test/Tsn2/sub/str"), QString("text"));
+    QCOMPARE( ArnM::valueByteArray("//Test/Tsn2/sub/bytes"), QByteArray("a b\nc"));
+    ArnItem  arnLoaded("//Test/Tsn2/sub/save");
+    QCOMPARE( arnLoaded.toInt(), 7);
+    QCOMPARE( arnLoaded.isSaveMode(), true);
+}
+
+
+void ArnUtest1::measureArnMDestroyTree()
+{
+    const int  leafNum = 100000;
+    for (int i = 0; i < leafNum; ++i) {
+        ArnM::setValue("//Test/Tdt1/big/s" + QString::number(i), i);
+    }
+    ArnItem  arnT1("//Test/Tdt1/big/s5");
+    QSignalSpy  spyDestroyed( &arnT1, SIGNAL(arnLinkDestroyed()));
+
+    QBENCHMARK_ONCE {  // The tree is gone after the first run
+        ArnM::destroyLink("//Test/Tdt1/");
+    }
+    QCOMPARE( spyDestroyed.count(), 1);
+    QCOMPARE( arnT1.isOpen(), false);
+    QVERIFY( ArnM::exist("//Test/Tdt1/big/s7") == false);
+
+    //// Small retired tree waiting for reclaim can be created again at once
+    ArnM::setValue("//Test/Tdt2/small/s1", 1);
+    ArnM::destroyLink("//Test/Tdt2/");
+    ArnM::setValue("//Test/Tdt2/small/s1", 2);
+    QCOMPARE( ArnM::valueInt("//Test/Tdt2/small/s1"), 2);
+    QCOMPARE( ArnM::items("//Test/Tdt2/small/").size(), 1);
+
+    //// Big retired tree is reclaimed in batches by the event loop, then it can be created again
+    QTRY_VERIFY( ArnM::items("//Test/").contains("Tdt1/") == false);
+    ArnM::setValue("//Test/Tdt1/big/s7", 7);
+    QCOMPARE( ArnM::valueInt("//Test/Tdt1/big/s7"), 7);
+    QCOMPARE( ArnM::items("//Test/Tdt1/big/").size(), 1);
+}
+
+
 void  ArnUtest1::testArnItem1()
 {
     ArnItem  arnT1a("//Test/Tf1/value");
@@ -547,6 +1044,576 @@ void  ArnUtest1::testArnItemNet1()
 }
 
 
+void  ArnUtest1::testArnItemNetTab()
+{
+    //// netIds from the inverse of the hash multiplier give chosen home slots
+    const quint32  hashMul = 0x9E3779B9u;
+    quint32  hashInv = hashMul;
+    for (int i = 0; i < 5; ++i) {
+        hashInv *= 2u - hashMul * hashInv;  // Newton iteration, inverse modulo 2^32
+    }
+    QCOMPARE( hashMul * hashInv, quint32(1));
+
+    QList<uint>  idList;
+    for (uint n = 0; n < 200; ++n) {
+        idList += n * hashInv;                  // All collide in the first slot
+        idList += (0xFFFFFFFFu - n) * hashInv;  // All collide in the last slot, probes wrap around
+        idList += 1000 + n * 3;                 // Near ids, as link ids in a session
+    }
+    QList<ArnItemNet*>  itemList;
+    for (int i = 0; i < 4; ++i) {
+        itemList += new ArnItemNet( arnNullptr);
+    }
+
+    //// Random inserts, replaces and removes checked against a QMap
+    ArnItemNetTab  tab;
+    QMap<uint,ArnItemNet*>  refMap;
+    quint32  rnd = 12345;
+    for (int op = 0; op < 20000; ++op) {
+        rnd = rnd * 1103515245u + 12345u;
+        uint  netId = idList.at( int( (rnd >> 8) % uint( idList.size())));
+        ArnItemNet*  itemNet = itemList.at( int( rnd >> 30));
+        if ((rnd >> 4) % 3) {
+            tab.insert( netId, itemNet);
+            refMap.insert( netId, itemNet);
+        }
+        else {
+            QCOMPARE( tab.remove( netId), int( refMap.remove( netId)));
+        }
+        QCOMPARE( tab.size(), int( refMap.size()));
+    }
+    foreach (uint netId, idList) {
+        QCOMPARE( tab.value( netId), refMap.value( netId));
+        QCOMPARE( tab.contains( netId), refMap.contains( netId));
+    }
+    QList<uint>  keys = tab.keys();
+    std::sort( keys.begin(), keys.end());
+    QCOMPARE( keys, refMap.keys());
+    QCOMPARE( int( tab.values().size()), int( refMap.size()));
+
+    foreach (uint netId, refMap.keys()) {
+        QCOMPARE( tab.remove( netId), 1);
+    }
+    QCOMPARE( tab.size(), 0);
+    foreach (uint netId, idList) {
+        QVERIFY( !tab.contains( netId));
+    }
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::measureArnSyncBinFrame_data()
+{
+    QTest::addColumn<bool>("offBinFrame");
+    QTest::newRow("text")   << true;
+    QTest::newRow("binary") << false;
+}
+
+
+void  ArnUtest1::measureArnSyncBinFrame()
+{
+    QFETCH( bool, offBinFrame);
+    const int  itemNum   = 200;
+    const int  valueSize = 4096;
+
+    QByteArray  value( valueSize, '\0');
+    for (int i = 0; i < valueSize; ++i) {
+        value[i] = char( i * 7);  // Binary data, much of it needs coding in text records
+    }
+
+    Arn::offBinFrame = offBinFrame;
+    QString  loopPath = QString("//Test/SyncLoop/%1/").arg( QTest::currentDataTag());
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient( loopPath + "Cli/", loopPath + "Srv/");
+    QVERIFY( sync.waitConnected());
+    QCOMPARE( client->commandStat().value("Rver"), QByteArray("1"));
+    QVERIFY( client->commandStat().value("Rinfo").toInt() > 0);  // Command code in binary frames
+
+    //// Items are made at the server before the measured rounds, only values are sent in them
+    for (int i = 0; i < itemNum; ++i) {
+        ArnM::setValue( loopPath + "Cli/v" + QString::number(i) + "/value", value);
+    }
+    QString  lastPath = loopPath + "Srv/v" + QString::number( itemNum - 1) + "/value";
+    QTRY_COMPARE( ArnM::valueByteArray( lastPath), value);
+
+    quint64  inStart;
+    quint64  outStart;
+    client->getTraffic( inStart, outStart);
+    int  roundCount = 0;
+    QBENCHMARK {
+        value[0] = char( ++roundCount);  // Each round is a new value
+        for (int i = 0; i < itemNum; ++i) {
+            ArnM::setValue( loopPath + "Cli/v" + QString::number(i) + "/value", value);
+        }
+        UTEST_WAIT( ArnM::valueByteArray( lastPath) == value);
+    }
+    QCOMPARE( ArnM::valueByteArray( lastPath), value);
+    Arn::offBinFrame = false;
+
+    quint64  in;
+    quint64  out;
+    client->getTraffic( in, out);
+    quint64  sentPerRound = (out - outStart) / quint64( roundCount);
+    if (offBinFrame)
+        QVERIFY( sentPerRound > quint64( itemNum * valueSize));  // Coding makes it bigger
+    else
+        QVERIFY( sentPerRound < quint64( itemNum * (valueSize + 64)));  // Only the frame added
+}
+
+
+void  ArnUtest1::measureArnSyncCompress()
+{
+#ifndef ARN_ZLIB
+    QSKIP("ArnLib is built without ArnZlib");
+#else
+    const int  itemNum = 500;
+
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient("//Test/SyncZip/Cli/", "//Test/SyncZip/Srv/", "localhost", true);
+    QVERIFY( sync.waitConnected());
+    QVERIFY( client->isCompressed());
+
+    QString  jsonTempl = "{\"type\":\"temperature\",\"unit\":\"C\",\"value\":%1}";
+    for (int i = 0; i < itemNum; ++i) {
+        ArnM::setValue( QString("//Test/SyncZip/Cli/sensor%1/value").arg(i), jsonTempl.arg( i % 40));
+    }
+    QString  lastPath = QString("//Test/SyncZip/Srv/sensor%1/value").arg( itemNum - 1);
+    QTRY_COMPARE( ArnM::valueString( lastPath), jsonTempl.arg( (itemNum - 1) % 40));
+
+    quint64  in;
+    quint64  out;
+    quint64  inRaw;
+    quint64  outRaw;
+    client->getTraffic( in, out, inRaw, outRaw);
+    QVERIFY( out < outRaw / 2);
+#endif
+}
+
+
+void  ArnUtest1::measureArnSyncResume()
+{
+    const int  itemNum = 300;
+
+    QByteArray  value( 1000, 'r');
+    for (int i = 0; i < itemNum; ++i) {
+        ArnM::setValue( QString("//Test/SyncRes/Srv/v%1/value").arg(i), value + QByteArray::number(i));
+    }
+
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient("//Test/SyncRes/Cli/", "//Test/SyncRes/Srv/");
+    sync.addClient("//Test/SyncRes/Cli2/", "//Test/SyncRes/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    QList<ArnItem*>  itemList;
+    for (int i = 0; i < itemNum; ++i) {
+        itemList += new ArnItem( QString("//Test/SyncRes/Cli/v%1/value").arg(i));
+    }
+    ArnItem  item2("//Test/SyncRes/Cli2/v9/value");
+    QTRY_COMPARE( itemList.last()->toByteArray(), value + QByteArray::number( itemNum - 1));
+    QTRY_COMPARE( item2.toByteArray(), value + QByteArray::number(9));
+
+    quint64  in0;
+    quint64  out0;
+    client->getTraffic( in0, out0);
+
+    //// Local writes while connected, the last is still queued at disconnect
+    *itemList.at(10) = QByteArray("local10");
+    *itemList.at(11) = QByteArray("local11");
+    client->disconnectFromArn();
+    QTRY_VERIFY( client->connectStatus() != ArnClient::ConnectStat::Connected);
+    ArnM::setValue("//Test/SyncRes/Srv/v7/value", QByteArray("changed"));
+    item2 = QByteArray("changedByCli2");  // Imported at the server, no local update there
+    QTRY_COMPARE( ArnM::valueByteArray("//Test/SyncRes/Srv/v9/value"), QByteArray("changedByCli2"));
+
+    client->connectToArn("localhost", sync._server.port());
+    QVERIFY( sync.waitConnected());
+    QTRY_COMPARE( itemList.at(7)->toByteArray(), QByteArray("changed"));
+    QTRY_COMPARE( itemList.at(9)->toByteArray(), QByteArray("changedByCli2"));
+    QTest::qWait(200);
+
+    quint64  in1;
+    quint64  out1;
+    client->getTraffic( in1, out1);
+    QVERIFY( (in1 - in0) < in0 / 10);
+    QCOMPARE( itemList.at(8)->toByteArray(), value + QByteArray::number(8));
+    //// Not resumed on a local value the server might not have got
+    for (int i = 10; i <= 11; ++i) {
+        QString  srvPath = QString("//Test/SyncRes/Srv/v%1/value").arg(i);
+        QTRY_COMPARE( itemList.at(i)->toByteArray(), ArnM::valueByteArray( srvPath));
+    }
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::measureArnSyncBulk()
+{
+    const int  itemNum = 2000;
+
+    for (int i = 0; i < itemNum; ++i) {
+        ArnM::setValue( QString("//Test/SyncBulk/Srv/ui/w%1/value").arg(i), i);
+    }
+
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient("//Test/SyncBulk/Cli/", "//Test/SyncBulk/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    QList<ArnItem*>  itemList;
+    QBENCHMARK_ONCE {  // Items are only subscribed once
+        for (int i = 0; i < itemNum; ++i) {
+            itemList += new ArnItem( QString("//Test/SyncBulk/Cli/ui/w%1/value").arg(i));
+        }
+        UTEST_WAIT( itemList.last()->toInt() == itemNum - 1);
+    }
+    QCOMPARE( itemList.last()->toInt(), itemNum - 1);
+
+    Arn::XStringMap  stat = client->commandStat();
+    QVERIFY( stat.value("fluxb").toInt() > 0);
+    QVERIFY( stat.value("fluxb").toInt() < itemNum / 100);  // Initial values in large batches
+    QCOMPARE( itemList.at( itemNum / 2)->toInt(), itemNum / 2);
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::measureArnSyncFanOut()
+{
+    const int  clientNum = 10;
+    const int  itemNum   = 200;
+
+    for (int i = 0; i < itemNum; ++i) {
+        ArnM::setValue( QString("//Test/SyncFan/Srv/v%1/value").arg(i), QByteArray("0"));
+    }
+
+    ArnUtest1Sync  sync;
+    QList<ArnItem*>  itemList;
+    for (int c = 0; c < clientNum; ++c) {
+        QString  cliPath = QString("//Test/SyncFan/Cli%1/").arg(c);
+        sync.addClient( cliPath, "//Test/SyncFan/Srv/");
+        for (int i = 0; i < itemNum; ++i) {
+            itemList += new ArnItem( cliPath + QString("v%1/value").arg(i));
+        }
+    }
+    QVERIFY( sync.waitConnected());
+    QTRY_COMPARE( itemList.last()->toByteArray(), QByteArray("0"));
+
+    QByteArray  value( 2000, 'f');
+    int  roundCount = 0;
+    QBENCHMARK {
+        value[0] = char('a' + ++roundCount % 26);  // Each round is a new value
+        for (int i = 0; i < itemNum; ++i) {
+            ArnM::setValue( QString("//Test/SyncFan/Srv/v%1/value").arg(i), value + QByteArray::number(i));
+        }
+        for (int c = 0; c < clientNum; ++c) {
+            UTEST_WAIT( itemList.at( c * itemNum + itemNum - 1)->toByteArray()
+                        == value + QByteArray::number( itemNum - 1));
+        }
+    }
+
+    for (int c = 0; c < clientNum; ++c) {  // Shared coded value with session specific id
+        QCOMPARE( itemList.at( c * itemNum + itemNum - 1)->toByteArray(), value + QByteArray::number( itemNum - 1));
+        QCOMPARE( itemList.at( c * itemNum + 17)->toByteArray(), value + QByteArray::number(17));
+    }
+
+    //// Value written by one client is imported at the server and must reach the other clients
+    *itemList.at(5) = QByteArray("fromCli0");
+    for (int c = 1; c < clientNum; ++c) {
+        QTRY_COMPARE( itemList.at( c * itemNum + 5)->toByteArray(), QByteArray("fromCli0"));
+    }
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::measureArnSyncPipeOverwrite()
+{
+    const int  queueNum = 10000;
+    const int  owNum    = 200;
+
+    ArnUtest1Sync  sync;
+    sync.addClient("//Test/SyncPipe/Cli/", "//Test/SyncPipe/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    ArnPipe  srvPipe("//Test/SyncPipe/Srv/pipe!");  // Provider at server side
+    QSignalSpy  spy( &srvPipe, SIGNAL(changed(QByteArray)));
+    ArnPipe  pipe("//Test/SyncPipe/Cli/pipe");
+    QTest::qWait(100);
+
+    //// Pipe is backed up, only the first record is written before back in event loop
+    for (int i = 0; i < queueNum; ++i) {
+        pipe = "msg" + QByteArray::number(i);
+    }
+    ARN_RegExp  rx("^last\\d");
+    QBENCHMARK {
+        for (int i = 0; i < owNum; ++i) {  // Each overwrite scans the whole queue
+            pipe.setValueOverwrite("last" + QByteArray::number(i), rx);
+        }
+    }
+
+    //// All messages in order, the overwrites replaced each other in the queue
+    QTRY_COMPARE( spy.count(), queueNum + 1);
+    for (int i = 0; i < queueNum; ++i) {
+        QCOMPARE( spy.at(i).at(0).toByteArray(), "msg" + QByteArray::number(i));
+    }
+    QCOMPARE( spy.at( queueNum).at(0).toByteArray(), QByteArray("last") + QByteArray::number( owNum - 1));
+    QTest::qWait(100);
+    QCOMPARE( spy.count(), queueNum + 1);
+}
+
+
+void  ArnUtest1::measureArnSyncPrio()
+{
+    const int  itemNum = 3000;
+
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient("//Test/SyncPrio/Cli/", "//Test/SyncPrio/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    QList<ArnItem*>  itemList;
+    for (int i = 0; i < itemNum; ++i) {
+        itemList += new ArnItem( QString("//Test/SyncPrio/Cli/bulk%1/value").arg(i));
+    }
+    ArnItem  ctrl;
+    ctrl.setPrio();
+    ctrl.open("//Test/SyncPrio/Cli/ctrl/value");
+    QTest::qWait(500);
+
+    QByteArray  value( 500, 'b');
+    for (int i = 0; i < itemNum; ++i) {
+        *itemList.at(i) = value + QByteArray::number(i);
+    }
+    ctrl = 1;  // Queued after all bulk updates
+
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncPrio/Srv/ctrl/value"), 1);
+    QTRY_COMPARE( ArnM::valueByteArray( QString("//Test/SyncPrio/Srv/bulk%1/value").arg( itemNum - 1)),
+                  value + QByteArray::number( itemNum - 1));
+
+    quint64  normCount;
+    quint64  normSum;
+    qint64   normMax;
+    quint64  prioCount;
+    quint64  prioSum;
+    qint64   prioMax;
+    client->getQueueDelayStat( false, normCount, normSum, normMax);
+    client->getQueueDelayStat( true,  prioCount, prioSum, prioMax);
+    QCOMPARE( prioCount, quint64(1));
+    QVERIFY( prioMax < normMax);
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::testArnServerIoThreads()
+{
+    const int  clientNum = 4;
+    const int  threadNum = 2;
+
+    ArnUtest1Sync  sync( threadNum);
+    QCOMPARE( sync._server.ioThreadNum(), threadNum);
+
+    QList<ArnItem*>  itemList;
+    for (int c = 0; c < clientNum; ++c) {
+        QString  cliPath = QString("//Test/SyncIo/Cli%1/").arg(c);
+        sync.addClient( cliPath, "//Test/SyncIo/Srv/");
+        itemList += new ArnItem( cliPath + "common/value");
+    }
+    QVERIFY( sync.waitConnected());
+
+    for (int c = 0; c < clientNum; ++c) {  // Client to session in I/O thread
+        ArnM::setValue( QString("//Test/SyncIo/Cli%1/c%1/value").arg(c), c + 1);
+    }
+    for (int c = 0; c < clientNum; ++c) {
+        QTRY_COMPARE( ArnM::valueInt( QString("//Test/SyncIo/Srv/c%1/value").arg(c)), c + 1);
+    }
+
+    ArnM::setValue("//Test/SyncIo/Srv/common/value", 42);  // Fan-out from all I/O threads
+    foreach (ArnItem* item, itemList) {
+        QTRY_COMPARE( item->toInt(), 42);
+    }
+
+    QString  statPath = Arn::pathServer + "IoThread/%1/Sessions/value";
+    QTRY_COMPARE( ArnM::valueInt( statPath.arg(0)) + ArnM::valueInt( statPath.arg(1)), clientNum);
+    QVERIFY( ArnM::valueInt( statPath.arg(0)) > 0);  // Spread over the threads
+    QVERIFY( ArnM::valueInt( statPath.arg(1)) > 0);
+
+    qDeleteAll( itemList);
+}
+
+
+void  ArnUtest1::testArnSyncTreeDestroy()
+{
+    ArnUtest1Sync  sync;
+    ArnClient*  client = sync.addClient("//Test/SyncTree/Cli/", "//Test/SyncTree/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    ArnItem  itemA("//Test/SyncTree/Cli/a/x/value");
+    ArnItem  itemB("//Test/SyncTree/Cli/b/c/value");
+    itemA = 1;
+    itemB = 2;
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncTree/Srv/a/x/value"), 1);
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncTree/Srv/b/c/value"), 2);
+
+    //// Tree without synced items, not sent to the session
+    ArnM::setValue("//Test/SyncTree/Srv/tmp/value", 3);
+    ArnM::destroyLink("//Test/SyncTree/Srv/tmp/");
+
+    //// Tree having synced items
+    ArnM::destroyLink("//Test/SyncTree/Srv/a/x/");
+    QTRY_VERIFY( ArnM::exist("//Test/SyncTree/Cli/a/x/") == false);
+    QVERIFY( ArnM::exist("//Test/SyncTree/Cli/a/") == true);
+
+    //// Ancestor of the synced items
+    ArnM::destroyLink("//Test/SyncTree/Srv/b/");
+    QTRY_VERIFY( ArnM::exist("//Test/SyncTree/Cli/b/c/") == false);
+
+    ArnItem  itemA2("//Test/SyncTree/Cli/a/x/value");  // Recreated tree is listened to again
+    itemA2 = 4;
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncTree/Srv/a/x/value"), 4);
+    ArnM::destroyLink("//Test/SyncTree/Srv/a/x/");
+    QTRY_VERIFY( ArnM::exist("//Test/SyncTree/Cli/a/x/") == false);
+
+    //// Ears in a folder and in its sub folder, only the topmost path is sent
+    ArnItem  itemD("//Test/SyncTree/Cli/d/value");
+    ArnItem  itemE("//Test/SyncTree/Cli/d/e/value");
+    itemD = 5;
+    itemE = 6;
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncTree/Srv/d/value"), 5);
+    QTRY_COMPARE( ArnM::valueInt("//Test/SyncTree/Srv/d/e/value"), 6);
+    int  deleteCount = client->commandStat().value("delete").toInt();
+    ArnM::destroyLink("//Test/SyncTree/Srv/d/");
+    QTRY_VERIFY( ArnM::exist("//Test/SyncTree/Cli/d/") == false);
+    QTest::qWait(100);
+    QCOMPARE( client->commandStat().value("delete").toInt(), deleteCount + 1);
+}
+
+
+/// Rows comparing the transports to a same host ArnServer
+static void  addSyncTransportRows( const QString& localName)
+{
+    QTest::addColumn<QString>("host");
+    QTest::newRow("tcp")   << QString("localhost");
+    QTest::newRow("local") << QString("local:") + localName;
+    QTest::newRow("shm")   << QString("shm:") + localName + "shm";
+}
+
+
+void  ArnUtest1::measureArnSyncLocalLatency_data()
+{
+    addSyncTransportRows("arnutest1");
+}
+
+
+void  ArnUtest1::measureArnSyncLocalLatency()
+{
+#ifdef Q_OS_UNIX
+    QFETCH( QString, host);
+
+    ArnUtest1Sync  sync;
+    QVERIFY( sync._server.startLocal("arnutest1"));
+    QCOMPARE( sync._server.localServerName(), QString("arnutest1"));
+    if (!sync._server.startShm("arnutest1shm") && host.startsWith("shm:"))
+        QSKIP("No shared memory transport on this platform");
+
+    QString  base = QString("//Test/SyncLocal/%1/").arg( QTest::currentDataTag());
+    sync.addClient( base + "Cli/", base + "Srv/", host);
+    QVERIFY( sync.waitConnected());
+
+    ArnItem  cliItem( base + "Cli/v/value");
+    ArnItem  srvItem( base + "Srv/v/value");
+    QTest::qWait(200);
+
+    //// One update at a time, each is at the server before the next
+    int  value = 0;
+    QBENCHMARK {
+        cliItem = ++value;
+        UTEST_WAIT( srvItem.toInt() == value);
+    }
+    QCOMPARE( srvItem.toInt(), value);
+#else
+    QSKIP("Local socket only on Unix");
+#endif
+}
+
+
+void  ArnUtest1::measureArnSyncLocalThroughput_data()
+{
+    addSyncTransportRows("arnutest1thr");
+}
+
+
+void  ArnUtest1::measureArnSyncLocalThroughput()
+{
+#ifdef Q_OS_UNIX
+    QFETCH( QString, host);
+    const int  msgNum = 10000;
+
+    ArnUtest1Sync  sync;
+    QVERIFY( sync._server.startLocal("arnutest1thr"));
+    if (!sync._server.startShm("arnutest1thrshm") && host.startsWith("shm:"))
+        QSKIP("No shared memory transport on this platform");
+
+    QString  base = QString("//Test/SyncThr/%1/").arg( QTest::currentDataTag());
+    sync.addClient( base + "Cli/", base + "Srv/", host);
+    QVERIFY( sync.waitConnected());
+
+    ArnPipe  srvPipe( base + "Srv/pipe!");  // Provider at server side
+    QSignalSpy  spy( &srvPipe, SIGNAL(changed(QByteArray)));
+    ArnPipe  pipe( base + "Cli/pipe");
+    QTest::qWait(200);
+
+    //// A high-rate producer, a pipe passes every message where an item would collapse them
+    QBENCHMARK {
+        spy.clear();
+        for (int i = 0; i < msgNum; ++i) {
+            pipe = QByteArray::number(i);
+        }
+        UTEST_WAIT( spy.count() >= msgNum);
+    }
+    QCOMPARE( spy.count(), msgNum);
+    QCOMPARE( spy.first().at(0).toByteArray(), QByteArray("0"));
+    QCOMPARE( spy.last().at(0).toByteArray(), QByteArray::number( msgNum - 1));
+#else
+    QSKIP("Local socket only on Unix");
+#endif
+}
+
+
+void  ArnUtest1::measureArnSyncFluxIngest()
+{
+    const int  itemNum = 20000;
+
+    ArnUtest1Sync  sync;
+    sync.addClient("//Test/SyncIngest/Cli/", "//Test/SyncIngest/Srv/");
+    QVERIFY( sync.waitConnected());
+
+    QList<ArnItem*>  itemList;
+    for (int i = 0; i < itemNum; ++i) {
+        itemList += new ArnItem( QString("//Test/SyncIngest/Cli/v%1/value").arg(i));
+    }
+    QList<ArnItem*>  srvItemList;
+    for (int i = 0; i < itemNum; ++i) {
+        srvItemList += new ArnItem( QString("//Test/SyncIngest/Srv/v%1/value").arg(i));
+    }
+    QTest::qWait(1000);
+
+    //// Each received flux record is looked up by netId in the client session
+    int  base = 0;
+    QBENCHMARK {
+        base += itemNum;  // Each round is new values
+        for (int i = 0; i < itemNum; ++i) {
+            *srvItemList.at(i) = base + i + 1;
+        }
+        UTEST_WAIT( itemList.last()->toInt() == base + itemNum);
+    }
+    QCOMPARE( itemList.last()->toInt(), base + itemNum);
+    QCOMPARE( itemList.at( itemNum / 2)->toInt(), base + itemNum / 2 + 1);
+
+    qDeleteAll( srvItemList);
+    qDeleteAll( itemList);
+}
+
+
 void ArnUtest1::testArnMonitorLocal()
 {
     ArnMonitor  arnMon;
@@ -5,6 +5,7 @@
 #-------------------------------------------------
 
 CONFIG += ArnLibCompile
+CONFIG += ArnZlib
 
 # Usage of internal mDNS code (no external dependency)
 # CONFIG += mDnsIntern
@@ -34,6 +35,7 @@ greaterThan(QT_MAJOR_VERSION, 5) {
 ArnLibCompile {
     ARN += core
     ARN += client
+    ARN += server
     ARN += qml
     #ARN += discover
     include(../../src/ArnLib.pri)